@@ -73,6 +73,9 @@ public class LlamaCore : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"Json",
+				"JsonUtilities",
+				"Projects",
 				// ... add private dependencies that you statically link with here ...
 			}
 			);
@@ -0,0 +1,634 @@
+// Copyright 2025-current Getnamo.
+
+#include "Embedding/LlamaCorpusIngestion.h"
+#include "Embedding/VectorDatabase.h"
+#include "LlamaNative.h"
+#include "LlamaUtility.h"
+#include "Async/Async.h"
+#include "Engine/DataTable.h"
+#include "HAL/PlatformProcess.h"
+#include "JsonObjectConverter.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+struct FCorpusIngestionChunk
+{
+    FString SourceKey;
+    int32 ChunkIndex = 0;
+    FString Text;
+};
+
+struct FCorpusIngestionBatch
+{
+    TArray<FCorpusIngestionChunk> Chunks;
+    TArray<float> Embeddings;
+    int32 Dimensions = 0;
+};
+
+typedef TSharedPtr<FCorpusIngestionBatch, ESPMode::ThreadSafe> FCorpusIngestionBatchPtr;
+
+struct FCorpusIngestionState
+{
+    FLlamaCorpusIngestionParams Params;
+    FLlamaNative* Native = nullptr;
+    FVectorDatabase* Database = nullptr;
+    TFunction<void(const FLlamaCorpusIngestionProgress&)> OnComplete;
+
+    //DataTable rows copied on the game thread, key -> row texts
+    TArray<TPair<FString, TArray<FString>>> TableSources;
+
+    //Read only for the reader, Checkpoint is owned by the inserter
+    FLlamaCorpusCheckpoint ResumeFrom;
+    FLlamaCorpusCheckpoint Checkpoint;
+    FString CheckpointPath;
+
+    //Inserter only. A source stops inserting after its first failed chunk so the committed prefix is exactly what's in the index.
+    TSet<FString> BrokenSources;
+    int32 BatchesSinceCheckpoint = 0;
+
+    //Embedded batches in submission order, produced on the LlamaNative BG thread
+    TQueue<FCorpusIngestionBatchPtr, EQueueMode::Mpsc> EmbeddedBatches;
+    FThreadSafeCounter BatchesInFlight = 0;
+
+    FThreadSafeBool bCancelled = false;
+    FThreadSafeBool bAborted = false;
+    FThreadSafeBool bReadingComplete = false;
+    FThreadSafeBool bFinished = false;
+    FThreadSafeBool bOwnerGone = false;   //set on the GT by the destructor, the completion task may still be queued
+
+    FThreadSafeCounter ChunksTotal = 0;
+    FThreadSafeCounter ChunksInserted = 0;
+    FThreadSafeCounter ChunksSkipped = 0;
+    FThreadSafeCounter ChunksFailed = 0;
+
+    double StartTime = 0.0;
+
+    FCriticalSection ErrorMutex;
+    FString ErrorMessage;
+
+    bool ShouldStop() const
+    {
+        return bCancelled || bAborted;
+    }
+
+    void Fail(const FString& Message)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion: %s"), *Message);
+        FScopeLock Lock(&ErrorMutex);
+        if (ErrorMessage.IsEmpty())
+        {
+            ErrorMessage = Message;
+        }
+        bAborted = true;
+    }
+
+    FLlamaCorpusIngestionProgress MakeProgress()
+    {
+        FLlamaCorpusIngestionProgress Progress;
+        Progress.ChunksTotal = ChunksTotal.GetValue();
+        Progress.ChunksInserted = ChunksInserted.GetValue();
+        Progress.ChunksSkipped = ChunksSkipped.GetValue();
+        Progress.ChunksFailed = ChunksFailed.GetValue();
+        Progress.bReadingComplete = bReadingComplete;
+        Progress.bCancelled = bCancelled;
+        Progress.Seconds = (float)(FPlatformTime::Seconds() - StartTime);
+
+        FScopeLock Lock(&ErrorMutex);
+        Progress.ErrorMessage = ErrorMessage;
+        return Progress;
+    }
+};
+
+namespace
+{
+    const float StageIdleSleep = 0.005f;
+
+    //Paragraphs are merged up to ChunkCharacters, oversized ones are windowed with overlap at word boundaries
+    void ChunkText(const FString& Text, int32 ChunkCharacters, int32 OverlapCharacters, TArray<FString>& OutChunks)
+    {
+        const int32 MaxChars = FMath::Max(ChunkCharacters, 32);
+        const int32 Overlap = FMath::Clamp(OverlapCharacters, 0, MaxChars / 2);
+
+        FString Normalized = Text.Replace(TEXT("\r\n"), TEXT("\n"));
+        TArray<FString> Paragraphs;
+        Normalized.ParseIntoArray(Paragraphs, TEXT("\n\n"), true);
+
+        FString Current;
+        auto FlushCurrent = [&]()
+        {
+            Current.TrimStartAndEndInline();
+            if (!Current.IsEmpty())
+            {
+                OutChunks.Add(Current);
+            }
+            Current.Reset();
+        };
+
+        for (FString& Paragraph : Paragraphs)
+        {
+            Paragraph.TrimStartAndEndInline();
+            if (Paragraph.IsEmpty())
+            {
+                continue;
+            }
+
+            if (Paragraph.Len() > MaxChars)
+            {
+                FlushCurrent();
+
+                int32 Start = 0;
+                while (Start < Paragraph.Len())
+                {
+                    int32 End = FMath::Min(Start + MaxChars, Paragraph.Len());
+
+                    //prefer breaking on whitespace in the back half of the window
+                    if (End < Paragraph.Len())
+                    {
+                        for (int32 i = End; i > Start + MaxChars / 2; i--)
+                        {
+                            if (FChar::IsWhitespace(Paragraph[i]))
+                            {
+                                End = i;
+                                break;
+                            }
+                        }
+                    }
+
+                    Current = Paragraph.Mid(Start, End - Start);
+                    FlushCurrent();
+
+                    if (End >= Paragraph.Len())
+                    {
+                        break;
+                    }
+                    Start = FMath::Max(End - Overlap, Start + 1);
+                }
+                continue;
+            }
+
+            if (!Current.IsEmpty() && Current.Len() + 2 + Paragraph.Len() > MaxChars)
+            {
+                FlushCurrent();
+            }
+            if (!Current.IsEmpty())
+            {
+                Current += TEXT("\n\n");
+            }
+            Current += Paragraph;
+        }
+        FlushCurrent();
+    }
+
+    //Accepts ["..."], [{Field: "..."}] or {"key": "..."}
+    bool ReadJsonTexts(const FString& JsonString, const FString& TextField, TArray<FString>& OutTexts)
+    {
+        TSharedPtr<FJsonValue> Root;
+        TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+        if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid())
+        {
+            return false;
+        }
+
+        if (Root->Type == EJson::Array)
+        {
+            for (const TSharedPtr<FJsonValue>& Item : Root->AsArray())
+            {
+                FString ItemText;
+                if (Item->TryGetString(ItemText))
+                {
+                    OutTexts.Add(ItemText);
+                }
+                else if (Item->Type == EJson::Object && Item->AsObject()->TryGetStringField(TextField, ItemText))
+                {
+                    OutTexts.Add(ItemText);
+                }
+            }
+            return true;
+        }
+        if (Root->Type == EJson::Object)
+        {
+            for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Root->AsObject()->Values)
+            {
+                FString ItemText;
+                if (Pair.Value->TryGetString(ItemText))
+                {
+                    OutTexts.Add(ItemText);
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    FString MakeSourceKey(const FString& Name, const TArray<FString>& Texts)
+    {
+        uint32 Crc = 0;
+        for (const FString& Text : Texts)
+        {
+            Crc = FCrc::StrCrc32(*Text, Crc);
+        }
+        return FString::Printf(TEXT("%s|%08x"), *Name, Crc);
+    }
+
+    //Index first, a crash between the two leaves a checkpoint that's behind the index (re-inserted), never ahead of it
+    void SaveCheckpoint(FCorpusIngestionState& State)
+    {
+        State.BatchesSinceCheckpoint = 0;
+        if (State.CheckpointPath.IsEmpty())
+        {
+            return;
+        }
+        if (!State.Database->SaveIndex(State.Params.IndexPath))
+        {
+            State.Fail(FString::Printf(TEXT("unable to save the index to %s, checkpoint not updated"), *State.Params.IndexPath));
+            return;
+        }
+        FString JsonString;
+        if (FJsonObjectConverter::UStructToJsonObjectString(State.Checkpoint, JsonString))
+        {
+            FFileHelper::SaveStringToFile(JsonString, *State.CheckpointPath);
+        }
+    }
+
+    //Blocks on backpressure, then hands the batch to the LlamaNative BG thread
+    void SubmitBatch(const TSharedPtr<FCorpusIngestionState, ESPMode::ThreadSafe>& State, FCorpusIngestionBatchPtr Batch)
+    {
+        const int32 MaxInFlight = FMath::Max(State->Params.MaxBatchesInFlight, 1);
+        while (State->BatchesInFlight.GetValue() >= MaxInFlight && !State->ShouldStop())
+        {
+            FPlatformProcess::Sleep(StageIdleSleep);
+        }
+        if (State->ShouldStop())
+        {
+            return;
+        }
+
+        TArray<FString> Texts;
+        Texts.Reserve(Batch->Chunks.Num());
+        for (const FCorpusIngestionChunk& Chunk : Batch->Chunks)
+        {
+            Texts.Add(Chunk.Text);
+        }
+
+        State->BatchesInFlight.Increment();
+        State->Native->GetPromptEmbeddingsBatch(Texts, [State, Batch](const TArray<float>& Embeddings, int32 Dimensions, const TArray<FString>& SourceTexts)
+        {
+            Batch->Embeddings = Embeddings;
+            Batch->Dimensions = Dimensions;
+            State->EmbeddedBatches.Enqueue(Batch);
+        }, false, [State]()
+        {
+            //Queued batches are skipped and the running one aborts, other requests on the native are unaffected
+            return State->ShouldStop();
+        });
+    }
+
+    void ReadSource(const TSharedPtr<FCorpusIngestionState, ESPMode::ThreadSafe>& State, const FString& Name,
+        const TArray<FString>& Texts, FCorpusIngestionBatchPtr& PendingBatch)
+    {
+        const FLlamaCorpusIngestionParams& Params = State->Params;
+        const FString SourceKey = MakeSourceKey(Name, Texts);
+        const int32* Committed = State->ResumeFrom.CommittedChunks.Find(SourceKey);
+        const int32 SkipCount = Committed ? *Committed : 0;
+
+        TArray<FString> Chunks;
+        for (const FString& Text : Texts)
+        {
+            ChunkText(Text, Params.ChunkCharacters, Params.ChunkOverlapCharacters, Chunks);
+        }
+
+        State->ChunksTotal.Add(Chunks.Num());
+
+        for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num() && !State->ShouldStop(); ChunkIndex++)
+        {
+            if (ChunkIndex < SkipCount)
+            {
+                State->ChunksSkipped.Increment();
+                continue;
+            }
+
+            FCorpusIngestionChunk& Chunk = PendingBatch->Chunks.AddDefaulted_GetRef();
+            Chunk.SourceKey = SourceKey;
+            Chunk.ChunkIndex = ChunkIndex;
+            Chunk.Text = MoveTemp(Chunks[ChunkIndex]);
+
+            if (PendingBatch->Chunks.Num() >= FMath::Max(Params.BatchSize, 1))
+            {
+                SubmitBatch(State, PendingBatch);
+                PendingBatch = MakeShared<FCorpusIngestionBatch, ESPMode::ThreadSafe>();
+            }
+        }
+    }
+
+    void RunReader(TSharedPtr<FCorpusIngestionState, ESPMode::ThreadSafe> State)
+    {
+        FCorpusIngestionBatchPtr PendingBatch = MakeShared<FCorpusIngestionBatch, ESPMode::ThreadSafe>();
+
+        for (const FString& Path : State->Params.FilePaths)
+        {
+            if (State->ShouldStop())
+            {
+                break;
+            }
+
+            const FString FullPath = FPaths::IsRelative(Path) ? FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Path) : Path;
+
+            FString FileString;
+            if (!FFileHelper::LoadFileToString(FileString, *FullPath))
+            {
+                UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion: unable to read %s, skipped"), *FullPath);
+                continue;
+            }
+
+            TArray<FString> Texts;
+            if (FPaths::GetExtension(FullPath).Equals(TEXT("json"), ESearchCase::IgnoreCase))
+            {
+                if (!ReadJsonTexts(FileString, State->Params.JsonTextField, Texts))
+                {
+                    UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion: %s is not a supported JSON layout, skipped"), *FullPath);
+                    continue;
+                }
+            }
+            else
+            {
+                Texts.Add(MoveTemp(FileString));
+            }
+
+            ReadSource(State, FullPath, Texts, PendingBatch);
+        }
+
+        for (const TPair<FString, TArray<FString>>& Table : State->TableSources)
+        {
+            if (State->ShouldStop())
+            {
+                break;
+            }
+            ReadSource(State, Table.Key, Table.Value, PendingBatch);
+        }
+
+        if (PendingBatch->Chunks.Num() > 0)
+        {
+            SubmitBatch(State, PendingBatch);
+        }
+
+        State->bReadingComplete = true;
+    }
+
+    void InsertBatch(FCorpusIngestionState& State, const FCorpusIngestionBatch& Batch)
+    {
+        const int32 NChunks = Batch.Chunks.Num();
+        const int32 Dimensions = Batch.Dimensions;
+
+        const bool bCheckpointing = !State.CheckpointPath.IsEmpty();
+
+        if (Dimensions <= 0 || Batch.Embeddings.Num() != NChunks * Dimensions)
+        {
+            //Embedding errors are already emitted through the native's OnError
+            State.ChunksFailed.Add(NChunks);
+            if (bCheckpointing)
+            {
+                for (const FCorpusIngestionChunk& Chunk : Batch.Chunks)
+                {
+                    State.BrokenSources.Add(Chunk.SourceKey);
+                }
+            }
+            return;
+        }
+        if (Dimensions != State.Database->Params.Dimensions)
+        {
+            State.Fail(FString::Printf(TEXT("embedding dimensions %d don't match the database's %d"), Dimensions, State.Database->Params.Dimensions));
+            State.ChunksFailed.Add(NChunks);
+            return;
+        }
+
+        TArray<float> Embedding;
+        for (int32 i = 0; i < NChunks; i++)
+        {
+            const FCorpusIngestionChunk& Chunk = Batch.Chunks[i];
+
+            //Chunks past a failure would be re-inserted as duplicates on resume, leave them for the resumed run
+            if (State.BrokenSources.Contains(Chunk.SourceKey))
+            {
+                State.ChunksFailed.Increment();
+                continue;
+            }
+
+            Embedding.Reset();
+            Embedding.Append(Batch.Embeddings.GetData() + (int64)i * Dimensions, Dimensions);
+            if (State.Database->AddVectorEmbeddingStringPair(Embedding, Chunk.Text) < 0)
+            {
+                State.ChunksFailed.Increment();
+                if (bCheckpointing)
+                {
+                    State.BrokenSources.Add(Chunk.SourceKey);
+                }
+                continue;
+            }
+            State.ChunksInserted.Increment();
+
+            //Batches arrive in submission order, so with broken sources skipped this is always the next chunk
+            State.Checkpoint.CommittedChunks.FindOrAdd(Chunk.SourceKey) = Chunk.ChunkIndex + 1;
+        }
+
+        if (bCheckpointing && ++State.BatchesSinceCheckpoint >= FMath::Max(State.Params.CheckpointIntervalBatches, 1))
+        {
+            SaveCheckpoint(State);
+        }
+    }
+
+    void RunInserter(TSharedPtr<FCorpusIngestionState, ESPMode::ThreadSafe> State)
+    {
+        while (true)
+        {
+            FCorpusIngestionBatchPtr Batch;
+            if (State->EmbeddedBatches.Dequeue(Batch))
+            {
+                if (!State->ShouldStop())
+                {
+                    InsertBatch(*State, *Batch);
+                }
+                State->BatchesInFlight.Decrement();
+                continue;
+            }
+
+            if (State->ShouldStop() || (State->bReadingComplete && State->BatchesInFlight.GetValue() == 0))
+            {
+                break;
+            }
+            FPlatformProcess::Sleep(StageIdleSleep);
+        }
+
+        //Persist whatever made it in, cancelled runs resume from here too
+        if (State->BatchesSinceCheckpoint > 0)
+        {
+            SaveCheckpoint(*State);
+        }
+
+        const FLlamaCorpusIngestionProgress Result = State->MakeProgress();
+        State->bFinished = true;
+
+        UE_LOG(LlamaLog, Log, TEXT("Corpus ingestion finished: %d inserted, %d skipped, %d failed of %d in %1.2fs"),
+            Result.ChunksInserted, Result.ChunksSkipped, Result.ChunksFailed, Result.ChunksTotal, Result.Seconds);
+
+        AsyncTask(ENamedThreads::GameThread, [State, Result]
+        {
+            if (!State->bOwnerGone && State->OnComplete)
+            {
+                State->OnComplete(Result);
+            }
+        });
+    }
+}
+
+bool FLlamaCorpusIngestion::Start(FLlamaNative* Native, FVectorDatabase* Database, const FLlamaCorpusIngestionParams& Params,
+    TFunction<void(const FLlamaCorpusIngestionProgress& Result)> OnComplete)
+{
+    check(IsInGameThread());
+
+    if (IsRunning())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion already running, cancel it first."));
+        return false;
+    }
+    if (!Native || !Database)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion requires a valid LlamaNative and VectorDatabase."));
+        return false;
+    }
+
+    //A cancelled run's reader may still be unwinding
+    if (ReaderFuture.IsValid())
+    {
+        ReaderFuture.Wait();
+    }
+
+    State = MakeShared<FCorpusIngestionState, ESPMode::ThreadSafe>();
+    State->Params = Params;
+    State->Params.DataTables.Empty();
+    State->Native = Native;
+    State->Database = Database;
+    State->OnComplete = OnComplete;
+    State->StartTime = FPlatformTime::Seconds();
+
+    //UObjects stay on the game thread, copy row texts now
+    for (const TObjectPtr<UDataTable>& Table : Params.DataTables)
+    {
+        if (!Table || !Table->GetRowStruct())
+        {
+            continue;
+        }
+
+        TArray<FString> RowTexts;
+        for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+        {
+            TArray<FString> Columns;
+            for (TFieldIterator<FProperty> It(Table->GetRowStruct()); It; ++It)
+            {
+                if (const FStrProperty* StrProperty = CastField<FStrProperty>(*It))
+                {
+                    Columns.Add(StrProperty->GetPropertyValue_InContainer(Row.Value));
+                }
+                else if (const FTextProperty* TextProperty = CastField<FTextProperty>(*It))
+                {
+                    Columns.Add(TextProperty->GetPropertyValue_InContainer(Row.Value).ToString());
+                }
+                else if (const FNameProperty* NameProperty = CastField<FNameProperty>(*It))
+                {
+                    Columns.Add(NameProperty->GetPropertyValue_InContainer(Row.Value).ToString());
+                }
+            }
+            Columns.RemoveAll([](const FString& Column) { return Column.IsEmpty(); });
+            if (Columns.Num() > 0)
+            {
+                RowTexts.Add(FString::Join(Columns, TEXT("\n")));
+            }
+        }
+        State->TableSources.Emplace(Table->GetPathName(), MoveTemp(RowTexts));
+    }
+
+    if (!Params.CheckpointName.IsEmpty() && Params.IndexPath.IsEmpty())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion: CheckpointName requires IndexPath, running without a checkpoint."));
+    }
+    else if (!Params.CheckpointName.IsEmpty())
+    {
+        State->CheckpointPath = FPaths::ProjectSavedDir() / TEXT("CorpusIngestion") / (FPaths::MakeValidFileName(Params.CheckpointName) + TEXT(".json"));
+
+        FString JsonString;
+        if (FFileHelper::LoadFileToString(JsonString, *State->CheckpointPath))
+        {
+            FJsonObjectConverter::JsonObjectStringToUStruct(JsonString, &State->ResumeFrom, 0, 0);
+        }
+
+        //The checkpoint describes the saved index, resume into it unless the caller already loaded a database
+        if (State->ResumeFrom.CommittedChunks.Num() > 0 && Database->Num() == 0 && !Database->LoadIndex(Params.IndexPath))
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("Corpus ingestion: unable to load %s, ignoring the checkpoint."), *Params.IndexPath);
+            State->ResumeFrom = FLlamaCorpusCheckpoint();
+        }
+        State->Checkpoint = State->ResumeFrom;
+    }
+
+    TSharedPtr<FCorpusIngestionState, ESPMode::ThreadSafe> SharedState = State;
+    ReaderFuture = Async(EAsyncExecution::Thread, [SharedState]
+    {
+        RunReader(SharedState);
+    });
+    InserterFuture = Async(EAsyncExecution::Thread, [SharedState]
+    {
+        RunInserter(SharedState);
+    });
+    return true;
+}
+
+void FLlamaCorpusIngestion::Cancel()
+{
+    if (State)
+    {
+        //Batches already queued on the native see this through their cancel check
+        State->bCancelled = true;
+    }
+}
+
+bool FLlamaCorpusIngestion::IsRunning() const
+{
+    return State.IsValid() && !State->bFinished;
+}
+
+FLlamaCorpusIngestionProgress FLlamaCorpusIngestion::GetProgress() const
+{
+    if (!State)
+    {
+        return FLlamaCorpusIngestionProgress();
+    }
+    return State->MakeProgress();
+}
+
+FLlamaCorpusIngestion::FLlamaCorpusIngestion()
+{
+}
+
+FLlamaCorpusIngestion::~FLlamaCorpusIngestion()
+{
+    //Stage threads touch the database and native, make sure they're gone. Queued embedding callbacks only hold State.
+    Cancel();
+    if (ReaderFuture.IsValid())
+    {
+        ReaderFuture.Wait();
+    }
+    if (InserterFuture.IsValid())
+    {
+        InserterFuture.Wait();
+    }
+
+    //OnComplete usually captures the owner, drop it so a completion task still in the GT queue can't call into it
+    if (State.IsValid())
+    {
+        State->bOwnerGone = true;
+        State->OnComplete = nullptr;
+    }
+}
@@ -0,0 +1,349 @@
+// Copyright 2025-current Getnamo.
+
+#include "Embedding/LlamaEmbeddingBenchmark.h"
+#include "Embedding/VectorDatabase.h"
+#include "Internal/LlamaInternal.h"
+#include "LlamaUtility.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IPluginManager.h"
+#include "JsonObjectConverter.h"
+#include "Math/RandomStream.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "common/common.h"
+#include "llama.h"
+
+#include <algorithm>
+
+namespace
+{
+    //Fixed seed and vocabulary, changing either invalidates comparisons with older reports
+    const int32 SyntheticCorpusSeed = 592;
+
+    const TCHAR* SyntheticWords[] = {
+        TEXT("the"), TEXT("knight"), TEXT("merchant"), TEXT("village"), TEXT("dragon"), TEXT("sword"), TEXT("ancient"),
+        TEXT("forest"), TEXT("river"), TEXT("castle"), TEXT("gold"), TEXT("quest"), TEXT("north"), TEXT("tavern"),
+        TEXT("potion"), TEXT("guard"), TEXT("secret"), TEXT("map"), TEXT("storm"), TEXT("mountain"), TEXT("king"),
+        TEXT("shield"), TEXT("travels"), TEXT("hides"), TEXT("sells"), TEXT("remembers"), TEXT("fears"), TEXT("under"),
+        TEXT("beyond"), TEXT("near"), TEXT("with"), TEXT("a"), TEXT("broken"), TEXT("silver"), TEXT("old"), TEXT("night"),
+        TEXT("festival"), TEXT("harvest"), TEXT("bandits"), TEXT("library"), TEXT("temple"), TEXT("wolf"), TEXT("ship"),
+        TEXT("harbor"), TEXT("letter"), TEXT("promise"), TEXT("debt"), TEXT("brother"), TEXT("sister"), TEXT("mine")
+    };
+
+    float PercentileOf(TArray<float>& Values, float Percentile)
+    {
+        if (Values.Num() == 0)
+        {
+            return 0.f;
+        }
+        Values.Sort();
+        const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Values.Num()) - 1, 0, Values.Num() - 1);
+        return Values[Index];
+    }
+}
+
+void FLlamaEmbeddingBenchmark::BuildCorpus(const FLlamaEmbeddingBenchmarkParams& BenchParams, TArray<FString>& OutTexts)
+{
+    const int32 CorpusSize = FMath::Max(BenchParams.CorpusSize, 1);
+
+    if (!BenchParams.CorpusFilePath.IsEmpty())
+    {
+        TArray<FString> Lines;
+        if (FFileHelper::LoadFileToStringArray(Lines, *FLlamaPaths::ParsePathIntoFullPath(BenchParams.CorpusFilePath)))
+        {
+            for (FString& Line : Lines)
+            {
+                Line.TrimStartAndEndInline();
+                if (!Line.IsEmpty())
+                {
+                    OutTexts.Add(Line);
+                }
+                if (OutTexts.Num() >= CorpusSize)
+                {
+                    return;
+                }
+            }
+            return;
+        }
+        UE_LOG(LlamaLog, Warning, TEXT("Benchmark corpus <%s> not readable, using synthetic corpus"), *BenchParams.CorpusFilePath);
+    }
+
+    FRandomStream Stream(SyntheticCorpusSeed);
+    const int32 NWords = UE_ARRAY_COUNT(SyntheticWords);
+
+    for (int32 i = 0; i < CorpusSize; i++)
+    {
+        const int32 Length = Stream.RandRange(8, 40);
+        FString Text;
+        for (int32 w = 0; w < Length; w++)
+        {
+            if (w > 0)
+            {
+                Text += TEXT(" ");
+            }
+            Text += SyntheticWords[Stream.RandRange(0, NWords - 1)];
+        }
+        OutTexts.Add(Text);
+    }
+}
+
+FLlamaEmbeddingBenchmarkReport FLlamaEmbeddingBenchmark::Run(const FLLMModelParams& ModelParams, const FLlamaEmbeddingBenchmarkParams& BenchParams,
+    TFunction<bool()> ShouldAbort)
+{
+    FLlamaEmbeddingBenchmarkReport Report;
+    Report.ModelPath = ModelParams.PathToModel;
+    Report.Timestamp = FDateTime::UtcNow().ToIso8601();
+
+    TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("Llama"));
+    if (Plugin.IsValid())
+    {
+        Report.PluginVersion = Plugin->GetDescriptor().VersionName;
+    }
+
+    FLLMModelParams BenchModelParams = ModelParams;
+    BenchModelParams.Advanced.bEmbeddingMode = true;
+    BenchModelParams.Advanced.bCreateEmbeddingContext = false;
+    BenchModelParams.Advanced.bUseEmbeddingCache = false;  //would turn the second pass into lookups
+    BenchModelParams.bAutoTuneHardware = false;
+    BenchModelParams.bPrefetchModelFile = false;
+    BenchModelParams.LoraAdapters.Empty();
+    BenchModelParams.ControlVectors.Empty();
+
+    //Scratch instance so the benchmark doesn't disturb the serving model's state.
+    //The abort reaches the weight load via its progress callback and the batched decodes via the abort callback.
+    FLlamaInternal* BenchInternal = new FLlamaInternal();
+    BenchInternal->SetRequestCancelCheck(ShouldAbort);
+
+    auto AbortRun = [&]()
+    {
+        UE_LOG(LlamaLog, Log, TEXT("Embedding benchmark aborted."));
+        delete BenchInternal;
+        return Report;
+    };
+
+    const bool bLoaded = BenchInternal->LoadModelFromParams(BenchModelParams);
+    if (ShouldAbort && ShouldAbort())
+    {
+        return AbortRun();
+    }
+    if (!bLoaded ||
+        llama_pooling_type(BenchInternal->Context) == LLAMA_POOLING_TYPE_NONE)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Embedding benchmark requires a pooled embedding model, <%s> failed to load or has no pooling."), *ModelParams.PathToModel);
+        delete BenchInternal;
+        Report.ReportPath = WriteReport(Report);
+        return Report;
+    }
+
+    TArray<FString> Corpus;
+    BuildCorpus(BenchParams, Corpus);
+
+    std::vector<std::string> CorpusStd;
+    CorpusStd.reserve(Corpus.Num());
+    for (const FString& Text : Corpus)
+    {
+        CorpusStd.push_back(FLlamaString::ToStd(Text));
+        Report.CorpusTokens += (int32)common_tokenize(BenchInternal->Context, CorpusStd.back(), true, true).size();
+    }
+    Report.CorpusTexts = Corpus.Num();
+
+    TArray<int32> ThreadCounts = BenchParams.ThreadCounts;
+    if (ThreadCounts.Num() == 0)
+    {
+        const int32 Cores = FMath::Max(FPlatformMisc::NumberOfCores(), 1);
+        ThreadCounts.AddUnique(1);
+        ThreadCounts.AddUnique(FMath::Max(Cores / 2, 1));
+        ThreadCounts.AddUnique(Cores);
+    }
+
+    std::vector<float> CorpusEmbeddings;
+    int32 Dimensions = 0;
+
+    for (int32 Threads : ThreadCounts)
+    {
+        Threads = FMath::Max(Threads, 1);
+        llama_set_n_threads(BenchInternal->Context, Threads, Threads);
+
+        //One decode per text
+        FLlamaEmbeddingThroughput Single;
+        Single.Threads = Threads;
+        Single.bBatched = false;
+        {
+            std::vector<float> Embedding;
+            const double Start = FPlatformTime::Seconds();
+            for (const std::string& Text : CorpusStd)
+            {
+                if (ShouldAbort && ShouldAbort())
+                {
+                    return AbortRun();
+                }
+                BenchInternal->GetPromptEmbeddings(Text, Embedding);
+            }
+            Single.Seconds = (float)(FPlatformTime::Seconds() - Start);
+        }
+
+        //Packed decodes
+        FLlamaEmbeddingThroughput Batched;
+        Batched.Threads = Threads;
+        Batched.bBatched = true;
+        {
+            const double Start = FPlatformTime::Seconds();
+            BenchInternal->GetPromptEmbeddingsBatch(CorpusStd, CorpusEmbeddings, Dimensions);
+            Batched.Seconds = (float)(FPlatformTime::Seconds() - Start);
+        }
+        if (ShouldAbort && ShouldAbort())
+        {
+            return AbortRun();
+        }
+
+        for (FLlamaEmbeddingThroughput* Result : { &Single, &Batched })
+        {
+            if (Result->Seconds > 0.f)
+            {
+                Result->TextsPerSecond = Report.CorpusTexts / Result->Seconds;
+                Result->TokensPerSecond = Report.CorpusTokens / Result->Seconds;
+            }
+            UE_LOG(LlamaLog, Log, TEXT("Embedding %s, %d threads: %.1f texts/s, %.1f tokens/s"),
+                Result->bBatched ? TEXT("batched") : TEXT("single"), Threads, Result->TextsPerSecond, Result->TokensPerSecond);
+            Report.Throughput.Add(*Result);
+        }
+    }
+
+    //Queries are word prefixes of corpus texts, ground truth comes from brute force so any query set works
+    std::vector<std::string> Queries;
+    FRandomStream QueryStream(SyntheticCorpusSeed + 1);
+    for (int32 i = 0; i < FMath::Max(BenchParams.QueryCount, 1); i++)
+    {
+        TArray<FString> Words;
+        Corpus[QueryStream.RandRange(0, Corpus.Num() - 1)].ParseIntoArrayWS(Words);
+        Words.SetNum(FMath::Max(Words.Num() / 2, 1));
+        Queries.push_back(FLlamaString::ToStd(FString::Join(Words, TEXT(" "))));
+    }
+
+    std::vector<float> QueryEmbeddings;
+    int32 QueryDimensions = 0;
+    BenchInternal->GetPromptEmbeddingsBatch(Queries, QueryEmbeddings, QueryDimensions);
+    if (ShouldAbort && ShouldAbort())
+    {
+        return AbortRun();
+    }
+
+    delete BenchInternal;
+
+    if (Dimensions > 0 && QueryDimensions == Dimensions &&
+        CorpusEmbeddings.size() == (size_t)Report.CorpusTexts * Dimensions)
+    {
+        Report.Dimensions = Dimensions;
+        MeasureRetrieval(CorpusEmbeddings, QueryEmbeddings, Dimensions, FMath::Clamp(BenchParams.RecallK, 1, Report.CorpusTexts), Report);
+        Report.bValid = true;
+    }
+
+    Report.ReportPath = WriteReport(Report);
+    return Report;
+}
+
+void FLlamaEmbeddingBenchmark::MeasureRetrieval(const std::vector<float>& CorpusEmbeddings, const std::vector<float>& QueryEmbeddings,
+    int32 Dimensions, int32 K, FLlamaEmbeddingBenchmarkReport& OutReport)
+{
+    const int32 NCorpus = (int32)(CorpusEmbeddings.size() / Dimensions);
+    const int32 NQueries = (int32)(QueryEmbeddings.size() / Dimensions);
+    OutReport.RecallK = K;
+
+    FVectorDatabase Database;
+    Database.Params.Dimensions = Dimensions;
+    Database.Params.MaxElements = NCorpus;
+    Database.InitializeDB();
+
+    TArray<int64> Ids;
+    Ids.SetNumUninitialized(NCorpus);
+    for (int32 i = 0; i < NCorpus; i++)
+    {
+        Ids[i] = i;
+    }
+
+    const double BuildStart = FPlatformTime::Seconds();
+    Database.AddVectors(CorpusEmbeddings.data(), Ids.GetData(), NCorpus);
+    OutReport.IndexBuildSeconds = (float)(FPlatformTime::Seconds() - BuildStart);
+
+    TArray<float> Vector;
+    TArray<float> IndexLatencies;
+    double BruteForceTotal = 0.0;
+    double RecallTotal = 0.0;
+    std::vector<std::pair<float, int32>> Distances(NCorpus);
+
+    for (int32 q = 0; q < NQueries; q++)
+    {
+        const float* Query = QueryEmbeddings.data() + (size_t)q * Dimensions;
+
+        //Exact top-k by squared L2, the index's metric
+        const double BruteStart = FPlatformTime::Seconds();
+        for (int32 i = 0; i < NCorpus; i++)
+        {
+            const float* Candidate = CorpusEmbeddings.data() + (size_t)i * Dimensions;
+            float Distance = 0.f;
+            for (int32 d = 0; d < Dimensions; d++)
+            {
+                const float Delta = Query[d] - Candidate[d];
+                Distance += Delta * Delta;
+            }
+            Distances[i] = { Distance, i };
+        }
+        std::partial_sort(Distances.begin(), Distances.begin() + K, Distances.end());
+        BruteForceTotal += FPlatformTime::Seconds() - BruteStart;
+
+        Vector.Reset();
+        Vector.Append(Query, Dimensions);
+
+        TArray<int64> Found;
+        const double IndexStart = FPlatformTime::Seconds();
+        Database.FindNearestNIds(Found, Vector, K);
+        IndexLatencies.Add((float)((FPlatformTime::Seconds() - IndexStart) * 1e6));
+
+        int32 Hits = 0;
+        for (int32 i = 0; i < K; i++)
+        {
+            if (Found.Contains((int64)Distances[i].second))
+            {
+                Hits++;
+            }
+        }
+        RecallTotal += (double)Hits / K;
+    }
+
+    if (NQueries > 0)
+    {
+        OutReport.RecallAtK = (float)(RecallTotal / NQueries);
+        OutReport.BruteForceQueryMicrosecondsMean = (float)(BruteForceTotal * 1e6 / NQueries);
+
+        double IndexTotal = 0.0;
+        for (float Latency : IndexLatencies)
+        {
+            IndexTotal += Latency;
+        }
+        OutReport.IndexQueryMicrosecondsMean = (float)(IndexTotal / NQueries);
+        OutReport.IndexQueryMicrosecondsP95 = PercentileOf(IndexLatencies, 0.95f);
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("Vector index recall@%d %.3f, query %.1fus mean (%.1fus p95), brute force %.1fus, build %.3fs"),
+        K, OutReport.RecallAtK, OutReport.IndexQueryMicrosecondsMean, OutReport.IndexQueryMicrosecondsP95,
+        OutReport.BruteForceQueryMicrosecondsMean, OutReport.IndexBuildSeconds);
+}
+
+FString FLlamaEmbeddingBenchmark::WriteReport(const FLlamaEmbeddingBenchmarkReport& Report)
+{
+    const FString ReportPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") /
+        FString::Printf(TEXT("EmbeddingBenchmark_%s.json"), *FDateTime::UtcNow().ToString(TEXT("%Y%m%d_%H%M%S")));
+
+    FString JsonString;
+    if (!FJsonObjectConverter::UStructToJsonObjectString(Report, JsonString) ||
+        !FFileHelper::SaveStringToFile(JsonString, *ReportPath))
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Unable to write embedding benchmark report to %s"), *ReportPath);
+        return FString();
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("Embedding benchmark report written to %s"), *ReportPath);
+    return ReportPath;
+}
@@ -0,0 +1,237 @@
+// Copyright 2025-current Getnamo.
+
+#include "Embedding/LlamaEmbeddingCache.h"
+#include "LlamaUtility.h"
+#include "Async/MappedFileHandle.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+
+namespace
+{
+    const uint32 StoreMagic = 0x434D454C;  //'LEMC'
+    const uint32 StoreVersion = 1;
+    const int32 FlushThreshold = 256;
+
+    struct FStoreHeader
+    {
+        uint32 Magic = StoreMagic;
+        uint32 Version = StoreVersion;
+        int32 Dimensions = 0;
+        uint32 Reserved = 0;
+    };
+}
+
+FCriticalSection FLlamaEmbeddingCache::RegistryMutex;
+TMap<FString, TWeakPtr<FLlamaEmbeddingCache>> FLlamaEmbeddingCache::Registry;
+
+TSharedPtr<FLlamaEmbeddingCache> FLlamaEmbeddingCache::Get(const FString& Namespace, int32 Dimensions, int32 MaxMemoryEntries, bool bPersistent)
+{
+    FScopeLock Lock(&RegistryMutex);
+
+    if (TWeakPtr<FLlamaEmbeddingCache>* Existing = Registry.Find(Namespace))
+    {
+        if (TSharedPtr<FLlamaEmbeddingCache> Pinned = Existing->Pin())
+        {
+            return Pinned;
+        }
+    }
+
+    TSharedPtr<FLlamaEmbeddingCache> Cache = MakeShareable(new FLlamaEmbeddingCache(Namespace, Dimensions, MaxMemoryEntries, bPersistent));
+    Registry.Add(Namespace, Cache);
+    return Cache;
+}
+
+uint64 FLlamaEmbeddingCache::HashText(const char* Text, int64 Length)
+{
+    return CityHash64(Text, (uint32)Length);
+}
+
+FLlamaEmbeddingCache::FLlamaEmbeddingCache(const FString& InNamespace, int32 InDimensions, int32 MaxMemoryEntries, bool bInPersistent)
+    : Dimensions(InDimensions)
+    , bPersistent(bInPersistent)
+    , MemoryCache(FMath::Max(MaxMemoryEntries, 1))
+{
+    StorePath = FPaths::ProjectSavedDir() / TEXT("EmbeddingCache") / (FMD5::HashAnsiString(*InNamespace) + TEXT(".bin"));
+
+    if (bPersistent)
+    {
+        OpenStore();
+    }
+}
+
+FLlamaEmbeddingCache::~FLlamaEmbeddingCache()
+{
+    Flush();
+    UnmapStore();
+}
+
+int64 FLlamaEmbeddingCache::RecordSize() const
+{
+    return sizeof(uint64) + (int64)Dimensions * sizeof(float);
+}
+
+void FLlamaEmbeddingCache::MapStore()
+{
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    if (!PlatformFile.FileExists(*StorePath))
+    {
+        return;
+    }
+
+    MappedHandle = PlatformFile.OpenMapped(*StorePath);
+    if (MappedHandle && MappedHandle->GetFileSize() > 0)
+    {
+        MappedRegion = MappedHandle->MapRegion(0, MappedHandle->GetFileSize());
+    }
+}
+
+void FLlamaEmbeddingCache::UnmapStore()
+{
+    delete MappedRegion;
+    MappedRegion = nullptr;
+    delete MappedHandle;
+    MappedHandle = nullptr;
+}
+
+void FLlamaEmbeddingCache::OpenStore()
+{
+    MapStore();
+    if (!MappedRegion)
+    {
+        return;
+    }
+
+    const uint8* Data = MappedRegion->GetMappedPtr();
+    const int64 Size = MappedRegion->GetMappedSize();
+
+    //Stale format or dimensions, start over
+    const FStoreHeader* Header = reinterpret_cast<const FStoreHeader*>(Data);
+    if (Size < (int64)sizeof(FStoreHeader) || Header->Magic != StoreMagic || Header->Version != StoreVersion || Header->Dimensions != Dimensions)
+    {
+        UnmapStore();
+        IFileManager::Get().Delete(*StorePath);
+        return;
+    }
+
+    //Only complete records, a torn tail from a crash is ignored and overwritten on next flush
+    const int64 RecordCount = (Size - sizeof(FStoreHeader)) / RecordSize();
+    DiskIndex.Reserve(RecordCount);
+    for (int64 i = 0; i < RecordCount; i++)
+    {
+        const int64 Offset = sizeof(FStoreHeader) + i * RecordSize();
+        uint64 Hash;
+        FMemory::Memcpy(&Hash, Data + Offset, sizeof(uint64));
+        DiskIndex.Add(Hash, Offset + sizeof(uint64));
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("Embedding cache opened with %lld stored entries"), RecordCount);
+}
+
+bool FLlamaEmbeddingCache::Find(uint64 TextHash, float* OutEmbedding)
+{
+    FScopeLock Lock(&Mutex);
+
+    if (const TArray<float>* Cached = MemoryCache.FindAndTouch(TextHash))
+    {
+        FMemory::Memcpy(OutEmbedding, Cached->GetData(), Dimensions * sizeof(float));
+        return true;
+    }
+
+    if (const int32* Pending = PendingIndex.Find(TextHash))
+    {
+        FMemory::Memcpy(OutEmbedding, PendingData.GetData() + (int64)*Pending * Dimensions, Dimensions * sizeof(float));
+        return true;
+    }
+
+    if (const int64* Offset = DiskIndex.Find(TextHash))
+    {
+        if (MappedRegion && *Offset + (int64)Dimensions * (int64)sizeof(float) <= MappedRegion->GetMappedSize())
+        {
+            FMemory::Memcpy(OutEmbedding, MappedRegion->GetMappedPtr() + *Offset, Dimensions * sizeof(float));
+            MemoryCache.Add(TextHash, TArray<float>(OutEmbedding, Dimensions));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FLlamaEmbeddingCache::Add(uint64 TextHash, const float* Embedding)
+{
+    FScopeLock Lock(&Mutex);
+
+    MemoryCache.Add(TextHash, TArray<float>(Embedding, Dimensions));
+
+    if (!bPersistent || DiskIndex.Contains(TextHash) || PendingIndex.Contains(TextHash))
+    {
+        return;
+    }
+
+    PendingIndex.Add(TextHash, PendingKeys.Num());
+    PendingKeys.Add(TextHash);
+    PendingData.Append(Embedding, Dimensions);
+
+    if (PendingKeys.Num() >= FlushThreshold)
+    {
+        Flush();
+    }
+}
+
+void FLlamaEmbeddingCache::Flush()
+{
+    FScopeLock Lock(&Mutex);
+
+    if (!bPersistent || PendingKeys.Num() == 0)
+    {
+        return;
+    }
+
+    //Can't append while mapped on all platforms
+    UnmapStore();
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(StorePath));
+
+    const bool bNewFile = !PlatformFile.FileExists(*StorePath);
+    TUniquePtr<IFileHandle> Writer(PlatformFile.OpenWrite(*StorePath, !bNewFile));
+    if (!Writer)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Embedding cache couldn't write to %s"), *StorePath);
+        MapStore();
+        return;
+    }
+
+    if (bNewFile)
+    {
+        FStoreHeader Header;
+        Header.Dimensions = Dimensions;
+        Writer->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FStoreHeader));
+    }
+    else
+    {
+        //Drop any torn tail so records stay aligned
+        const int64 ValidSize = sizeof(FStoreHeader) + ((Writer->Size() - (int64)sizeof(FStoreHeader)) / RecordSize()) * RecordSize();
+        Writer->Seek(ValidSize);
+        Writer->Truncate(ValidSize);
+    }
+
+    int64 Offset = Writer->Tell();
+    for (int32 i = 0; i < PendingKeys.Num(); i++)
+    {
+        Writer->Write(reinterpret_cast<const uint8*>(&PendingKeys[i]), sizeof(uint64));
+        Writer->Write(reinterpret_cast<const uint8*>(PendingData.GetData() + (int64)i * Dimensions), Dimensions * sizeof(float));
+        DiskIndex.Add(PendingKeys[i], Offset + sizeof(uint64));
+        Offset += RecordSize();
+    }
+    Writer.Reset();
+
+    PendingIndex.Empty();
+    PendingKeys.Empty();
+    PendingData.Empty();
+
+    MapStore();
+}
@@ -1,31 +1,640 @@
 // Copyright 2025-current Getnamo.
 
 #include "Embedding/VectorDatabase.h"
+#include "Algo/BinarySearch.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 #include "hnswlib/hnswlib.h"
 #include "LlamaUtility.h"
+#include <functional>
+#include <sstream>
+#include <streambuf>
+
+namespace
+{
+    const uint32 IndexMagic = 0x4244564C;  //'LVDB'
+    const uint32 IndexVersion = 2;
+
+    //Followed by GraphBytes of hnswlib's own index format, then the serialized text database
+    struct FIndexHeader
+    {
+        uint32 Magic = IndexMagic;
+        uint32 Version = IndexVersion;
+        int32 Dimensions = 0;
+        int32 MaxElements = 0;
+        int32 M = 0;
+        int32 EFConstruction = 0;
+        uint32 Metric = 0;
+        uint32 Reserved = 0;
+        int64 TextDatabaseMaxId = 0;
+        int64 GraphBytes = 0;
+    };
+
+    const uint32 MappedIndexMagic = 0x4D44564C;  //'LVDM'
+    const uint32 MappedIndexVersion = 1;
+
+    //Sections start on cache line boundaries of the mapping
+    const int64 SectionAlignment = 64;
+
+    //hnswlib's default query ef, kept the same so both index forms return the same results
+    const size_t DefaultEf = 10;
+
+    //Followed by the level-0 block, link index, link data, text index and text data sections at the stored offsets
+    struct FMappedIndexHeader
+    {
+        uint32 Magic = MappedIndexMagic;
+        uint32 Version = MappedIndexVersion;
+        int32 Dimensions = 0;
+        uint32 Metric = 0;
+        int32 M = 0;
+        int32 EFConstruction = 0;
+        int32 MaxM = 0;
+        int32 MaxM0 = 0;
+        int32 MaxLevel = 0;
+        uint32 EntryPoint = 0;
+        int64 ElementCount = 0;
+        int64 DeletedCount = 0;
+        int64 SizeDataPerElement = 0;
+        int64 OffsetData = 0;
+        int64 LabelOffset = 0;
+        int64 SizeLinksPerElement = 0;
+        int64 Level0Offset = 0;
+        int64 LinkIndexOffset = 0;
+        int64 LinkDataOffset = 0;
+        int64 LinkDataBytes = 0;
+        int64 TextIndexOffset = 0;
+        int64 TextCount = 0;
+        int64 TextDataOffset = 0;
+        int64 TextDataBytes = 0;
+        int64 TextDatabaseMaxId = 0;
+    };
+
+    //Element -> its upper level link lists (Level lists of SizeLinksPerElement bytes) within the link data
+    struct FMappedLinkEntry
+    {
+        int64 Offset = 0;
+        int32 Level = 0;
+        int32 Reserved = 0;
+    };
+
+    //Sorted by Id, utf8 bytes within the text data
+    struct FMappedTextEntry
+    {
+        int64 Id = 0;
+        int64 Offset = 0;
+        int64 Bytes = 0;
+    };
+
+    //Read-only std::istream source over a loaded file, hnswlib's loader seeks to validate the graph size
+    class FMemoryStreamBuf : public std::streambuf
+    {
+    public:
+        FMemoryStreamBuf(const uint8* Data, int64 Size)
+        {
+            char* Begin = (char*)Data;
+            setg(Begin, Begin, Begin + Size);
+        }
+
+    protected:
+        virtual pos_type seekoff(off_type Offset, std::ios_base::seekdir Dir, std::ios_base::openmode Which) override
+        {
+            char* Base = Dir == std::ios_base::beg ? eback() : (Dir == std::ios_base::end ? egptr() : gptr());
+            char* Target = Base + Offset;
+            if (Target < eback() || Target > egptr())
+            {
+                return pos_type(off_type(-1));
+            }
+            setg(eback(), Target, egptr());
+            return pos_type(Target - eback());
+        }
+
+        virtual pos_type seekpos(pos_type Position, std::ios_base::openmode Which) override
+        {
+            return seekoff(off_type(Position), std::ios_base::beg, Which);
+        }
+    };
+
+    //hnswlib picks SSE/AVX/AVX512 kernels for both spaces at construction
+    TUniquePtr<hnswlib::SpaceInterface<float>> MakeSpace(EVectorDBMetric Metric, int32 Dimensions)
+    {
+        if (Metric == EVectorDBMetric::L2)
+        {
+            return MakeUnique<hnswlib::L2Space>(Dimensions);
+        }
+        return MakeUnique<hnswlib::InnerProductSpace>(Dimensions);
+    }
+
+    FString ResolveIndexPath(const FString& Path)
+    {
+        return FPaths::IsRelative(Path) ? FPaths::ProjectSavedDir() / Path : Path;
+    }
+}
+
+//Read-only HNSW over a memory mapped file. The level-0 block is hnswlib's own element layout (links, vector, label)
+//so the search below mirrors HierarchicalNSW::searchKnn against it without copying anything into memory.
+class FMappedHNSW
+{
+public:
+    ~FMappedHNSW()
+    {
+        delete Region;
+        Region = nullptr;
+        delete Handle;
+        Handle = nullptr;
+    }
+
+    static bool Write(const FString& FullPath, hnswlib::HierarchicalNSW<float>& HNSW, int32 Dimensions, EVectorDBMetric Metric,
+        const TMap<int64, FString>& TextDatabase, int64 TextDatabaseMaxId)
+    {
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FullPath));
+
+        TUniquePtr<IFileHandle> Writer(PlatformFile.OpenWrite(*FullPath));
+        if (!Writer)
+        {
+            return false;
+        }
+
+        const int64 Count = (int64)HNSW.cur_element_count;
+
+        FMappedIndexHeader Header;
+        Header.Dimensions = Dimensions;
+        Header.Metric = (uint32)Metric;
+        Header.M = (int32)HNSW.M_;
+        Header.EFConstruction = (int32)HNSW.ef_construction_;
+        Header.MaxM = (int32)HNSW.maxM_;
+        Header.MaxM0 = (int32)HNSW.maxM0_;
+        Header.MaxLevel = HNSW.maxlevel_;
+        Header.EntryPoint = HNSW.enterpoint_node_;
+        Header.ElementCount = Count;
+        Header.DeletedCount = (int64)HNSW.num_deleted_;
+        Header.SizeDataPerElement = (int64)HNSW.size_data_per_element_;
+        Header.OffsetData = (int64)HNSW.offsetData_;
+        Header.LabelOffset = (int64)HNSW.label_offset_;
+        Header.SizeLinksPerElement = (int64)HNSW.size_links_per_element_;
+        Header.TextDatabaseMaxId = TextDatabaseMaxId;
+
+        bool bOk = Writer->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FMappedIndexHeader));
+
+        auto PadToSection = [&]()
+        {
+            static const uint8 Zeros[SectionAlignment] = {};
+            const int64 Padding = AlignUp(Writer->Tell(), SectionAlignment) - Writer->Tell();
+            bOk = bOk && (Padding == 0 || Writer->Write(Zeros, Padding));
+            return Writer->Tell();
+        };
+
+        Header.Level0Offset = PadToSection();
+        bOk = bOk && Writer->Write(reinterpret_cast<const uint8*>(HNSW.data_level0_memory_), Count * Header.SizeDataPerElement);
+
+        //Upper level link lists, indexed per element
+        TArray<FMappedLinkEntry> LinkEntries;
+        LinkEntries.SetNumZeroed(Count);
+        int64 LinkBytes = 0;
+        for (int64 i = 0; i < Count; i++)
+        {
+            LinkEntries[i].Offset = LinkBytes;
+            LinkEntries[i].Level = HNSW.element_levels_[i];
+            LinkBytes += LinkEntries[i].Level * Header.SizeLinksPerElement;
+        }
+
+        Header.LinkIndexOffset = PadToSection();
+        bOk = bOk && Writer->Write(reinterpret_cast<const uint8*>(LinkEntries.GetData()), Count * sizeof(FMappedLinkEntry));
+
+        Header.LinkDataOffset = PadToSection();
+        Header.LinkDataBytes = LinkBytes;
+        for (int64 i = 0; i < Count && bOk; i++)
+        {
+            if (LinkEntries[i].Level > 0)
+            {
+                bOk = Writer->Write(reinterpret_cast<const uint8*>(HNSW.linkLists_[i]), LinkEntries[i].Level * Header.SizeLinksPerElement);
+            }
+        }
+
+        //Text sorted by id for binary search, utf8 blob
+        TArray<int64> TextIds;
+        TextDatabase.GetKeys(TextIds);
+        TextIds.Sort();
+
+        TArray<FMappedTextEntry> TextEntries;
+        TArray<uint8> TextBlob;
+        TextEntries.Reserve(TextIds.Num());
+        for (int64 Id : TextIds)
+        {
+            FTCHARToUTF8 Utf8(*TextDatabase.FindChecked(Id));
+            FMappedTextEntry& Entry = TextEntries.AddDefaulted_GetRef();
+            Entry.Id = Id;
+            Entry.Offset = TextBlob.Num();
+            Entry.Bytes = Utf8.Length();
+            TextBlob.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+        }
+
+        Header.TextIndexOffset = PadToSection();
+        Header.TextCount = TextEntries.Num();
+        bOk = bOk && Writer->Write(reinterpret_cast<const uint8*>(TextEntries.GetData()), TextEntries.Num() * sizeof(FMappedTextEntry));
+
+        Header.TextDataOffset = PadToSection();
+        Header.TextDataBytes = TextBlob.Num();
+        bOk = bOk && Writer->Write(TextBlob.GetData(), TextBlob.Num());
+
+        bOk = bOk && Writer->Seek(0) && Writer->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FMappedIndexHeader));
+        return bOk;
+    }
+
+    bool Open(const FString& FullPath)
+    {
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        Handle = PlatformFile.OpenMapped(*FullPath);
+        if (!Handle || Handle->GetFileSize() < (int64)sizeof(FMappedIndexHeader))
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB couldn't map %s"), *FullPath);
+            return false;
+        }
+        Region = Handle->MapRegion(0, Handle->GetFileSize());
+        if (!Region)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB couldn't map %s"), *FullPath);
+            return false;
+        }
+
+        Base = Region->GetMappedPtr();
+        FileSize = Region->GetMappedSize();
+        FMemory::Memcpy(&Header, Base, sizeof(FMappedIndexHeader));
+
+        //Per element link bounds are checked lazily during search so opening stays O(1)
+        const int64 VectorBytes = (int64)Header.Dimensions * sizeof(float);
+        const int64 Level0LinkBytes = (int64)Header.MaxM0 * sizeof(uint32) + sizeof(uint32);
+        const bool bValid = Header.Magic == MappedIndexMagic && Header.Version == MappedIndexVersion &&
+            Header.Dimensions > 0 && Header.Metric <= (uint32)EVectorDBMetric::Cosine && Header.ElementCount >= 0 &&
+            Header.OffsetData >= Level0LinkBytes && Header.OffsetData + VectorBytes <= Header.LabelOffset &&
+            Header.LabelOffset + (int64)sizeof(hnswlib::labeltype) <= Header.SizeDataPerElement &&
+            Header.SizeLinksPerElement >= (int64)Header.MaxM * sizeof(uint32) + sizeof(uint32) &&
+            (Header.ElementCount == 0 || (Header.EntryPoint < (uint64)Header.ElementCount && Header.MaxLevel >= 0)) &&
+            Fits(Header.Level0Offset, Header.ElementCount * Header.SizeDataPerElement) &&
+            Fits(Header.LinkIndexOffset, Header.ElementCount * (int64)sizeof(FMappedLinkEntry)) &&
+            Fits(Header.LinkDataOffset, Header.LinkDataBytes) &&
+            Fits(Header.TextIndexOffset, Header.TextCount * (int64)sizeof(FMappedTextEntry)) &&
+            Fits(Header.TextDataOffset, Header.TextDataBytes) &&
+            Header.TextCount <= MAX_int32;
+        if (!bValid)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s is not a supported mapped index file"), *FullPath);
+            return false;
+        }
+
+        Level0 = Base + Header.Level0Offset;
+        LinkEntries = reinterpret_cast<const FMappedLinkEntry*>(Base + Header.LinkIndexOffset);
+        LinkData = Base + Header.LinkDataOffset;
+        TextEntries = TArrayView<const FMappedTextEntry>(reinterpret_cast<const FMappedTextEntry*>(Base + Header.TextIndexOffset), (int32)Header.TextCount);
+        TextData = Base + Header.TextDataOffset;
+
+        Space = MakeSpace((EVectorDBMetric)Header.Metric, Header.Dimensions);
+        Distance = Space->get_dist_func();
+        DistanceParam = Space->get_dist_func_param();
+        return true;
+    }
+
+    int32 Num() const
+    {
+        return (int32)Header.ElementCount;
+    }
+
+    const FMappedIndexHeader& GetHeader() const
+    {
+        return Header;
+    }
+
+    //Nearest first. False if the graph turns out to be corrupt.
+    bool Search(const float* Query, int32 K, TArray<int64>& OutIds) const
+    {
+        if (Header.ElementCount == 0)
+        {
+            return true;
+        }
+
+        uint32 Current = (uint32)Header.EntryPoint;
+        float CurrentDistance = Distance(Query, VectorOf(Current), DistanceParam);
+
+        //Greedy descent through the upper levels
+        for (int32 Level = Header.MaxLevel; Level > 0; Level--)
+        {
+            bool bChanged = true;
+            while (bChanged)
+            {
+                bChanged = false;
+                const uint32* Links = UpperLinks(Current, Level);
+                if (!Links)
+                {
+                    return false;
+                }
+                const int32 LinkCount = FMath::Min<int32>(*reinterpret_cast<const uint16*>(Links), Header.MaxM);
+                for (int32 i = 0; i < LinkCount; i++)
+                {
+                    const uint32 Candidate = Links[1 + i];
+                    if (Candidate >= (uint64)Header.ElementCount)
+                    {
+                        return false;
+                    }
+                    const float CandidateDistance = Distance(Query, VectorOf(Candidate), DistanceParam);
+                    if (CandidateDistance < CurrentDistance)
+                    {
+                        CurrentDistance = CandidateDistance;
+                        Current = Candidate;
+                        bChanged = true;
+                    }
+                }
+            }
+        }
+
+        //Beam search on level 0, same termination rule as searchBaseLayerST
+        typedef std::pair<float, uint32> FDistanceId;
+        const size_t Ef = FMath::Max<size_t>(DefaultEf, K);
+        const bool bHasDeletions = Header.DeletedCount > 0;
+
+        std::priority_queue<FDistanceId> Top;
+        std::priority_queue<FDistanceId, std::vector<FDistanceId>, std::greater<FDistanceId>> Candidates;
+        TBitArray<> Visited(false, (int32)Header.ElementCount);
+
+        float LowerBound = TNumericLimits<float>::Max();
+        if (!IsDeleted(Current))
+        {
+            Top.emplace(CurrentDistance, Current);
+            LowerBound = CurrentDistance;
+        }
+        Candidates.emplace(CurrentDistance, Current);
+        Visited[Current] = true;
+
+        while (!Candidates.empty())
+        {
+            const FDistanceId Closest = Candidates.top();
+            if (Closest.first > LowerBound && (Top.size() == Ef || !bHasDeletions))
+            {
+                break;
+            }
+            Candidates.pop();
+
+            const uint32* Links = Level0Links(Closest.second);
+            const int32 LinkCount = FMath::Min<int32>(*reinterpret_cast<const uint16*>(Links), Header.MaxM0);
+            for (int32 i = 0; i < LinkCount; i++)
+            {
+                const uint32 Neighbor = Links[1 + i];
+                if (Neighbor >= (uint64)Header.ElementCount)
+                {
+                    return false;
+                }
+                if (Visited[Neighbor])
+                {
+                    continue;
+                }
+                Visited[Neighbor] = true;
+
+                const float NeighborDistance = Distance(Query, VectorOf(Neighbor), DistanceParam);
+                if (Top.size() < Ef || LowerBound > NeighborDistance)
+                {
+                    Candidates.emplace(NeighborDistance, Neighbor);
+                    if (!IsDeleted(Neighbor))
+                    {
+                        Top.emplace(NeighborDistance, Neighbor);
+                    }
+                    if (Top.size() > Ef)
+                    {
+                        Top.pop();
+                    }
+                    if (!Top.empty())
+                    {
+                        LowerBound = Top.top().first;
+                    }
+                }
+            }
+        }
+
+        while (Top.size() > (size_t)K)
+        {
+            Top.pop();
+        }
+
+        const int32 Start = OutIds.Num();
+        OutIds.AddUninitialized((int32)Top.size());
+        for (int32 i = OutIds.Num() - 1; i >= Start; i--)
+        {
+            OutIds[i] = LabelOf(Top.top().second);
+            Top.pop();
+        }
+        return true;
+    }
+
+    bool FindText(int64 Id, FString& OutText) const
+    {
+        const int32 Index = Algo::BinarySearchBy(TextEntries, Id, &FMappedTextEntry::Id);
+        if (Index == INDEX_NONE)
+        {
+            return false;
+        }
+
+        const FMappedTextEntry& Entry = TextEntries[Index];
+        if (Entry.Offset < 0 || Entry.Bytes < 0 || Entry.Offset + Entry.Bytes > Header.TextDataBytes)
+        {
+            return false;
+        }
+        FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(TextData + Entry.Offset), (int32)Entry.Bytes);
+        OutText = FString(Converter.Length(), Converter.Get());
+        return true;
+    }
+
+private:
+    static int64 AlignUp(int64 Value, int64 Alignment)
+    {
+        return (Value + Alignment - 1) / Alignment * Alignment;
+    }
+
+    bool Fits(int64 Offset, int64 Bytes) const
+    {
+        return Offset >= (int64)sizeof(FMappedIndexHeader) && Bytes >= 0 && Offset + Bytes <= FileSize;
+    }
+
+    const uint8* ElementOf(uint32 Id) const
+    {
+        return Level0 + (int64)Id * Header.SizeDataPerElement;
+    }
+
+    const float* VectorOf(uint32 Id) const
+    {
+        return reinterpret_cast<const float*>(ElementOf(Id) + Header.OffsetData);
+    }
+
+    const uint32* Level0Links(uint32 Id) const
+    {
+        return reinterpret_cast<const uint32*>(ElementOf(Id));
+    }
+
+    //Null if the element doesn't reach that level or its list falls outside the file
+    const uint32* UpperLinks(uint32 Id, int32 Level) const
+    {
+        const FMappedLinkEntry& Entry = LinkEntries[Id];
+        const int64 Offset = Entry.Offset + (int64)(Level - 1) * Header.SizeLinksPerElement;
+        if (Level > Entry.Level || Entry.Offset < 0 || Offset + Header.SizeLinksPerElement > Header.LinkDataBytes)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<const uint32*>(LinkData + Offset);
+    }
+
+    //Same mark hnswlib's markDelete sets
+    bool IsDeleted(uint32 Id) const
+    {
+        return (ElementOf(Id)[2] & hnswlib::HierarchicalNSW<float>::DELETE_MARK) != 0;
+    }
+
+    int64 LabelOf(uint32 Id) const
+    {
+        hnswlib::labeltype Label;
+        FMemory::Memcpy(&Label, ElementOf(Id) + Header.LabelOffset, sizeof(hnswlib::labeltype));
+        return (int64)Label;
+    }
+
+    IMappedFileHandle* Handle = nullptr;
+    IMappedFileRegion* Region = nullptr;
+
+    const uint8* Base = nullptr;
+    int64 FileSize = 0;
+    FMappedIndexHeader Header;
+
+    const uint8* Level0 = nullptr;
+    const FMappedLinkEntry* LinkEntries = nullptr;
+    const uint8* LinkData = nullptr;
+    TArrayView<const FMappedTextEntry> TextEntries;
+    const uint8* TextData = nullptr;
+
+    TUniquePtr<hnswlib::SpaceInterface<float>> Space;
+    hnswlib::DISTFUNC<float> Distance = nullptr;
+    void* DistanceParam = nullptr;
+};
 
 class FHNSWPrivate
 {
 public:
-    hnswlib::HierarchicalNSW<float>* HNSW = nullptr;
+    //The index keeps raw pointers into the space's distance params, so the space lives exactly as long as the index
+    TUniquePtr<hnswlib::SpaceInterface<float>> Space;
+    TUniquePtr<hnswlib::HierarchicalNSW<float>> HNSW;
+
+    //Set instead of HNSW while a mapped index is open
+    TUniquePtr<FMappedHNSW> Mapped;
+
+    //Dimensions and metric the space was built with, Params may be edited afterwards
+    int32 Dimensions = 0;
+    EVectorDBMetric Metric = EVectorDBMetric::L2;
 
     void InitializeHNSW(const FVectorDBParams& Params)
     {
         ReleaseHNSWIfAllocated();
 
-        hnswlib::L2Space Space(Params.Dimensions);
-        HNSW = new hnswlib::HierarchicalNSW<float>(&Space, Params.MaxElements, Params.M, Params.EFConstruction);
+        Space = MakeSpace(Params.Metric, Params.Dimensions);
+        HNSW = MakeUnique<hnswlib::HierarchicalNSW<float>>(Space.Get(), Params.MaxElements, Params.M, Params.EFConstruction);
+        Dimensions = Params.Dimensions;
+        Metric = Params.Metric;
+    }
+
+    bool LoadHNSW(std::istream& Input, const FVectorDBParams& Params)
+    {
+        TUniquePtr<hnswlib::SpaceInterface<float>> LoadedSpace = MakeSpace(Params.Metric, Params.Dimensions);
+        TUniquePtr<hnswlib::HierarchicalNSW<float>> LoadedHNSW = MakeUnique<hnswlib::HierarchicalNSW<float>>(LoadedSpace.Get());
+
+        hnswlib::Status Status = LoadedHNSW->loadIndexNoExceptions(Input, LoadedSpace.Get(), Params.MaxElements);
+        if (!Status.ok())
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB graph load failed: %hs"), Status.message());
+            return false;
+        }
+
+        ReleaseHNSWIfAllocated();
+        Space = MoveTemp(LoadedSpace);
+        HNSW = MoveTemp(LoadedHNSW);
+        Dimensions = Params.Dimensions;
+        Metric = Params.Metric;
+        return true;
+    }
+
+    bool OpenMapped(const FString& FullPath)
+    {
+        TUniquePtr<FMappedHNSW> Opened = MakeUnique<FMappedHNSW>();
+        if (!Opened->Open(FullPath))
+        {
+            return false;
+        }
+
+        ReleaseHNSWIfAllocated();
+        Mapped = MoveTemp(Opened);
+        Dimensions = Mapped->GetHeader().Dimensions;
+        Metric = (EVectorDBMetric)Mapped->GetHeader().Metric;
+        return true;
     }
 
     void ReleaseHNSWIfAllocated()
     {
-        if (HNSW)
+        HNSW.Reset();
+        Space.Reset();
+        Mapped.Reset();
+        Dimensions = 0;
+    }
+
+    //Cosine stores and queries unit vectors, other metrics use the data as is
+    const float* PrepareVector(const float* Vector, TArray<float>& Scratch) const
+    {
+        if (Metric != EVectorDBMetric::Cosine)
+        {
+            return Vector;
+        }
+
+        float SquaredNorm = 0.f;
+        for (int32 i = 0; i < Dimensions; i++)
+        {
+            SquaredNorm += Vector[i] * Vector[i];
+        }
+        const float Scale = SquaredNorm > 0.f ? 1.f / FMath::Sqrt(SquaredNorm) : 0.f;
+
+        Scratch.SetNumUninitialized(Dimensions);
+        for (int32 i = 0; i < Dimensions; i++)
+        {
+            Scratch[i] = Vector[i] * Scale;
+        }
+        return Scratch.GetData();
+    }
+
+    //Safe to call concurrently, hnswlib locks per node and per label
+    hnswlib::Status AddPoint(const float* Vector, int64 UniqueId, TArray<float>& Scratch)
+    {
+        return HNSW->addPointNoExceptions(PrepareVector(Vector, Scratch), (hnswlib::labeltype)UniqueId);
+    }
+
+    //Logs why a vector can't be used with this index
+    bool IsUsable(int32 VectorDimensions, const TCHAR* Operation) const
+    {
+        if (Mapped)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s isn't supported on a mapped index, use LoadIndex for a writable one"), Operation);
+            return false;
+        }
+        if (!HNSW)
         {
-            delete HNSW;
-            HNSW = nullptr;
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s called before InitializeDB/LoadIndex"), Operation);
+            return false;
         }
+        if (VectorDimensions != Dimensions)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s got %d dimensions, index expects %d"), Operation, VectorDimensions, Dimensions);
+            return false;
+        }
+        return true;
     }
+
     ~FHNSWPrivate()
     {
         ReleaseHNSWIfAllocated();
@@ -42,81 +651,216 @@ void FVectorDatabase::BasicsTest()
     std::mt19937 rng;
     rng.seed(47);
     std::uniform_real_distribution<> distrib_real;
-    float* data = new float[Params.Dimensions * Params.MaxElements];
-    for (int i = 0; i < Params.Dimensions * Params.MaxElements; i++)
+    TArray<float> Data;
+    Data.SetNumUninitialized(Params.Dimensions * Params.MaxElements);
+    for (int i = 0; i < Data.Num(); i++)
     {
-        data[i] = distrib_real(rng);
+        Data[i] = distrib_real(rng);
     }
 
+    TArray<float> Vector;
+    auto SetVector = [&](int32 Index)
+    {
+        Vector.Reset();
+        Vector.Append(Data.GetData() + Index * Params.Dimensions, Params.Dimensions);
+    };
+
     // Add data to index
     for (int i = 0; i < Params.MaxElements; i++)
     {
-        Private->HNSW->addPoint(data + i * Params.Dimensions, i);
+        SetVector(i);
+        AddVectorEmbeddingIdPair(Vector, i);
     }
 
     // Query the elements for themselves and measure recall
-    float correct = 0;
-    for (int i = 0; i < Params.MaxElements; i++)
+    auto MeasureRecall = [&]()
     {
-        std::priority_queue<std::pair<float, hnswlib::labeltype>> result = Private->HNSW->searchKnn(data + i * Params.Dimensions, 1);
-        hnswlib::labeltype label = result.top().second;
-        if (label == i) correct++;
-    }
-    float recall = correct / Params.MaxElements;
-
-    UE_LOG(LogTemp, Log, TEXT("Recall: %1.3f"), recall);
-
-    // Serialize index
-    FString SavePath = FPaths::ProjectSavedDir() / TEXT("hnsw.bin");
-    std::string HNSWPath = FLlamaString::ToStd(SavePath);
-    Private->HNSW->saveIndex(HNSWPath);
-    delete Private->HNSW;
+        float Correct = 0;
+        for (int i = 0; i < Params.MaxElements; i++)
+        {
+            SetVector(i);
+            if (FindNearestId(Vector) == i) Correct++;
+        }
+        return Correct / Params.MaxElements;
+    };
 
-    // Deserialize index and check recall
-    // This test appears to fail in unreal context (loading index)
-    hnswlib::L2Space Space(Params.Dimensions);
-    Private->HNSW = new hnswlib::HierarchicalNSW<float>(&Space, HNSWPath, false, Params.MaxElements);
-    //HNSW = new hnswlib::HierarchicalNSW<float>(&space, max_elements, M, ef_construction);
-    //HNSW->loadIndex(HNSWPath, &space);
+    UE_LOG(LogTemp, Log, TEXT("Recall: %1.3f"), MeasureRecall());
 
-    if (Private->HNSW->getMaxElements() > 0)
+    // Serialize index, deserialize and check recall
+    const FString SavePath = TEXT("hnsw.bin");
+    if (SaveIndex(SavePath) && LoadIndex(SavePath))
     {
-        correct = 0;
-        for (int i = 0; i < Private->HNSW->getMaxElements(); i++)
-        {
-            std::priority_queue<std::pair<float, hnswlib::labeltype>> result = Private->HNSW->searchKnn(data + i * Params.Dimensions, 1);
-            hnswlib::labeltype label = result.top().second;
-            if (label == i) correct++;
-        }
-        recall = (float)correct / Params.MaxElements;
-        UE_LOG(LogTemp, Log, TEXT("Recall of deserialized index: %1.3f"), recall);
+        UE_LOG(LogTemp, Log, TEXT("Recall of deserialized index: %1.3f"), MeasureRecall());
     }
     else
     {
         UE_LOG(LogTemp, Log, TEXT("Failed to load index from file correctly"));
+        return;
+    }
+
+    // Same graph searched in place from a mapped file
+    const FString MappedPath = TEXT("hnsw.lvdm");
+    if (SaveMappedIndex(MappedPath) && OpenMappedIndex(MappedPath))
+    {
+        UE_LOG(LogTemp, Log, TEXT("Recall of mapped index: %1.3f"), MeasureRecall());
     }
-    delete[] data;
-    //delete HNSW; //handled at deconstructor atm
+    else
+    {
+        UE_LOG(LogTemp, Log, TEXT("Failed to map index from file correctly"));
+    }
+
+    //Unmap so the test files can be overwritten by the next run
+    InitializeDB();
 }
 
 void FVectorDatabase::InitializeDB()
 {
+    if (Params.Dimensions <= 0 || Params.MaxElements <= 0)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB needs positive Dimensions and MaxElements, got %d and %d"), Params.Dimensions, Params.MaxElements);
+        return;
+    }
+
     //Delete and re-initialize as needed
     Private->InitializeHNSW(Params);
+
+    FScopeLock Lock(&TextDatabaseMutex);
+    TextDatabase.Empty();
+    TextDatabaseMaxId = 0;
+}
+
+bool FVectorDatabase::IsInitialized() const
+{
+    return Private->HNSW.IsValid() || Private->Mapped.IsValid();
+}
+
+bool FVectorDatabase::IsMapped() const
+{
+    return Private->Mapped.IsValid();
+}
+
+int32 FVectorDatabase::Num() const
+{
+    if (Private->Mapped)
+    {
+        return Private->Mapped->Num();
+    }
+    return Private->HNSW ? (int32)Private->HNSW->getCurrentElementCount() : 0;
+}
+
+bool FVectorDatabase::AddVectorEmbeddingIdPair(const TArray<float>& Embedding, int64 UniqueId)
+{
+    if (!Private->IsUsable(Embedding.Num(), TEXT("add")))
+    {
+        return false;
+    }
+
+    TArray<float> Normalized;
+    hnswlib::Status Status = Private->AddPoint(Embedding.GetData(), UniqueId, Normalized);
+    if (!Status.ok())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB add of id %lld failed: %hs"), UniqueId, Status.message());
+        return false;
+    }
+    return true;
+}
+
+int32 FVectorDatabase::AddVectors(const float* Vectors, const int64* UniqueIds, int32 Count)
+{
+    if (Count <= 0 || !Private->IsUsable(Private->Dimensions, TEXT("bulk add")))
+    {
+        return 0;
+    }
+
+    const int32 Dimensions = Private->Dimensions;
+    if (Num() + Count > (int32)Private->HNSW->getMaxElements())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB bulk add of %d may exceed MaxElements %d, new ids past capacity will fail"),
+            Count, (int32)Private->HNSW->getMaxElements());
+    }
+
+    FThreadSafeCounter Added;
+    FThreadSafeCounter Failed;
+    const char* FirstError = nullptr;
+    FCriticalSection ErrorMutex;
+
+    auto AddRange = [&](int32 Start, int32 End)
+    {
+        TArray<float> Normalized;
+        for (int32 i = Start; i < End; i++)
+        {
+            hnswlib::Status Status = Private->AddPoint(Vectors + (int64)i * Dimensions, UniqueIds[i], Normalized);
+            if (Status.ok())
+            {
+                Added.Increment();
+            }
+            else if (Failed.Increment() == 1)
+            {
+                FScopeLock Lock(&ErrorMutex);
+                FirstError = Status.message();
+            }
+        }
+    };
+
+    //hnswlib sets the entry point on the first insert, do that one alone like its python bindings do
+    int32 Start = 0;
+    if (Num() == 0)
+    {
+        AddRange(0, 1);
+        Start = 1;
+    }
+
+    //Blocks keep per-task scratch and scheduling overhead small relative to a graph insert
+    const int32 BlockSize = 64;
+    const int32 Remaining = Count - Start;
+    const int32 NumBlocks = FMath::DivideAndRoundUp(Remaining, BlockSize);
+    ParallelFor(NumBlocks, [&](int32 Block)
+    {
+        const int32 BlockStart = Start + Block * BlockSize;
+        AddRange(BlockStart, FMath::Min(BlockStart + BlockSize, Count));
+    });
+
+    if (Failed.GetValue() > 0)
+    {
+        FScopeLock Lock(&ErrorMutex);
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB bulk add failed for %d of %d vectors: %hs"), Failed.GetValue(), Count, FirstError);
+    }
+    return Added.GetValue();
 }
 
-void FVectorDatabase::AddVectorEmbeddingIdPair(const TArray<float>& Embedding, int64 UniqueId)
+int32 FVectorDatabase::AddVectors(const TArray<float>& Vectors, const TArray<int64>& UniqueIds)
 {
-    Private->HNSW->addPoint(&Embedding, UniqueId);
+    if (Vectors.Num() != UniqueIds.Num() * Private->Dimensions)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB bulk add got %d floats for %d ids, index expects %d dimensions"),
+            Vectors.Num(), UniqueIds.Num(), Private->Dimensions);
+        return 0;
+    }
+    return AddVectors(Vectors.GetData(), UniqueIds.GetData(), UniqueIds.Num());
 }
 
-void FVectorDatabase::AddVectorEmbeddingStringPair(const TArray<float>& Embedding, const FString& Text)
+int64 FVectorDatabase::AddVectorEmbeddingStringPair(const TArray<float>& Embedding, const FString& Text)
 {
-    TextDatabaseMaxId++;
-    int64 UniqueId = TextDatabaseMaxId;
-    TextDatabase.Add(UniqueId, Text);
+    if (!Private->IsUsable(Embedding.Num(), TEXT("add")))
+    {
+        return -1;
+    }
 
-    AddVectorEmbeddingIdPair(Embedding, UniqueId);
+    int64 UniqueId;
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        TextDatabaseMaxId++;
+        UniqueId = TextDatabaseMaxId;
+        TextDatabase.Add(UniqueId, Text);
+    }
+
+    if (!AddVectorEmbeddingIdPair(Embedding, UniqueId))
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        TextDatabase.Remove(UniqueId);
+        return -1;
+    }
+    return UniqueId;
 }
 
 int64 FVectorDatabase::FindNearestId(const TArray<float>& ForEmbedding)
@@ -150,12 +894,44 @@ FString FVectorDatabase::FindNearestString(const TArray<float>& ForEmbedding)
 
 void FVectorDatabase::FindNearestNIds(TArray<int64>& IdResults, const TArray<float>& ForEmbedding, int32 N)
 {
-    std::priority_queue<std::pair<float, hnswlib::labeltype>> Results = Private->HNSW->searchKnn(&ForEmbedding, N);
+    if (N <= 0)
+    {
+        return;
+    }
+
+    TArray<float> Normalized;
+    if (Private->Mapped)
+    {
+        if (ForEmbedding.Num() != Private->Dimensions)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB search got %d dimensions, index expects %d"), ForEmbedding.Num(), Private->Dimensions);
+        }
+        else if (!Private->Mapped->Search(Private->PrepareVector(ForEmbedding.GetData(), Normalized), N, IdResults))
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB mapped index is corrupt, search aborted"));
+        }
+        return;
+    }
 
-    while (!Results.empty())
+    if (!Private->IsUsable(ForEmbedding.Num(), TEXT("search")))
     {
-        const std::pair<float, hnswlib::labeltype>& Item = Results.top();
-        IdResults.Add(static_cast<int64>(Item.second));
+        return;
+    }
+
+    auto MaybeResults = Private->HNSW->searchKnnNoExceptions(Private->PrepareVector(ForEmbedding.GetData(), Normalized), N);
+    if (!MaybeResults.ok())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB search failed: %hs"), MaybeResults.status().message());
+        return;
+    }
+
+    //Max heap on distance, pops farthest first
+    std::priority_queue<std::pair<float, hnswlib::labeltype>> Results = MaybeResults.value();
+    const int32 Start = IdResults.Num();
+    IdResults.AddUninitialized((int32)Results.size());
+    for (int32 i = IdResults.Num() - 1; i >= Start; i--)
+    {
+        IdResults[i] = static_cast<int64>(Results.top().second);
         Results.pop();
     }
 }
@@ -165,6 +941,20 @@ void FVectorDatabase::FindNearestNStrings(TArray<FString>& StringResults, const
     TArray<int64> Ids;
     FindNearestNIds(Ids, ForEmbedding, N);
 
+    if (Private->Mapped)
+    {
+        FString StringResult;
+        for (int64 Id : Ids)
+        {
+            if (Private->Mapped->FindText(Id, StringResult))
+            {
+                StringResults.Add(StringResult);
+            }
+        }
+        return;
+    }
+
+    FScopeLock Lock(&TextDatabaseMutex);
     for (int64 Id : Ids)
     {
         FString* MaybeResult = TextDatabase.Find(Id);
@@ -176,23 +966,186 @@ void FVectorDatabase::FindNearestNStrings(TArray<FString>& StringResults, const
     }
 }
 
-FVectorDatabase::FVectorDatabase()
+bool FVectorDatabase::SaveIndex(const FString& Path)
 {
-    Private = new FHNSWPrivate();
+    if (!Private->IsUsable(Private->Dimensions, TEXT("SaveIndex")))
+    {
+        return false;
+    }
+
+    std::ostringstream GraphStream(std::ios::binary);
+    Private->HNSW->saveIndex(GraphStream);
+    const std::string Graph = GraphStream.str();
+
+    FIndexHeader Header;
+    Header.Dimensions = Private->Dimensions;
+    Header.MaxElements = (int32)Private->HNSW->getMaxElements();
+    Header.M = (int32)Private->HNSW->M_;
+    Header.EFConstruction = (int32)Private->HNSW->ef_construction_;
+    Header.Metric = (uint32)Private->Metric;
+    Header.GraphBytes = (int64)Graph.size();
+
+    TArray<uint8> TextBytes;
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        Header.TextDatabaseMaxId = TextDatabaseMaxId;
+        FMemoryWriter Writer(TextBytes);
+        Writer << TextDatabase;
+    }
+
+    //Write beside and swap in so a failed save never leaves a torn index
+    const FString FullPath = ResolveIndexPath(Path);
+    const FString TempPath = FullPath + TEXT(".tmp");
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FullPath));
+
+    TUniquePtr<IFileHandle> Writer(PlatformFile.OpenWrite(*TempPath));
+    if (!Writer)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB couldn't write to %s"), *TempPath);
+        return false;
+    }
+
+    const bool bWritten = Writer->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FIndexHeader)) &&
+        Writer->Write(reinterpret_cast<const uint8*>(Graph.data()), Header.GraphBytes) &&
+        Writer->Write(TextBytes.GetData(), TextBytes.Num());
+    Writer.Reset();
+
+    if (!bWritten || !IFileManager::Get().Move(*FullPath, *TempPath, true))
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB failed to save %s"), *FullPath);
+        PlatformFile.DeleteFile(*TempPath);
+        return false;
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("VectorDB saved %d entries to %s"), Num(), *FullPath);
+    return true;
+}
+
+bool FVectorDatabase::LoadIndex(const FString& Path)
+{
+    const FString FullPath = ResolveIndexPath(Path);
+
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *FullPath))
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB couldn't read %s"), *FullPath);
+        return false;
+    }
+
+    FIndexHeader Header;
+    if (Bytes.Num() < (int64)sizeof(FIndexHeader))
+    {
+        Header.Magic = 0;
+    }
+    else
+    {
+        FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(FIndexHeader));
+    }
+    if (Header.Magic != IndexMagic || Header.Version != IndexVersion || Header.Dimensions <= 0 ||
+        Header.Metric > (uint32)EVectorDBMetric::Cosine || Header.GraphBytes < 0 || (int64)sizeof(FIndexHeader) + Header.GraphBytes > Bytes.Num())
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s is not a supported index file"), *FullPath);
+        return false;
+    }
+
+    FVectorDBParams LoadedParams = Params;
+    LoadedParams.Dimensions = Header.Dimensions;
+    LoadedParams.M = Header.M;
+    LoadedParams.EFConstruction = Header.EFConstruction;
+    LoadedParams.Metric = (EVectorDBMetric)Header.Metric;
+
+    //Keep any extra capacity the caller asked for before loading
+    LoadedParams.MaxElements = FMath::Max(Header.MaxElements, Params.MaxElements);
+
+    TMap<int64, FString> LoadedText;
+    {
+        FMemoryReader Reader(Bytes);
+        Reader.Seek(sizeof(FIndexHeader) + Header.GraphBytes);
+        Reader << LoadedText;
+        if (Reader.IsError())
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("VectorDB %s has a corrupt text database"), *FullPath);
+            return false;
+        }
+    }
+
+    FMemoryStreamBuf GraphBuffer(Bytes.GetData() + sizeof(FIndexHeader), Header.GraphBytes);
+    std::istream GraphStream(&GraphBuffer);
+    if (!Private->LoadHNSW(GraphStream, LoadedParams))
+    {
+        return false;
+    }
+
+    Params = LoadedParams;
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        TextDatabase = MoveTemp(LoadedText);
+        TextDatabaseMaxId = Header.TextDatabaseMaxId;
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("VectorDB loaded %d entries from %s"), Num(), *FullPath);
+    return true;
+}
+
+bool FVectorDatabase::SaveMappedIndex(const FString& Path)
+{
+    if (!Private->IsUsable(Private->Dimensions, TEXT("SaveMappedIndex")))
+    {
+        return false;
+    }
+
+    const FString FullPath = ResolveIndexPath(Path);
+    const FString TempPath = FullPath + TEXT(".tmp");
+
+    bool bWritten;
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        bWritten = FMappedHNSW::Write(TempPath, *Private->HNSW, Private->Dimensions, Private->Metric, TextDatabase, TextDatabaseMaxId);
+    }
+
+    //A file mapped by this or another process can't be replaced on every platform, the old one stays valid then
+    if (!bWritten || !IFileManager::Get().Move(*FullPath, *TempPath, true))
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("VectorDB failed to save mapped index %s"), *FullPath);
+        IFileManager::Get().Delete(*TempPath);
+        return false;
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("VectorDB saved %d entries to mapped index %s"), Num(), *FullPath);
+    return true;
+}
+
+bool FVectorDatabase::OpenMappedIndex(const FString& Path)
+{
+    const FString FullPath = ResolveIndexPath(Path);
+    if (!Private->OpenMapped(FullPath))
+    {
+        return false;
+    }
 
-    //llamainternal
-    //1. Load model
-    //2. Tokenize input
-    //3. llama_model_n_embd & embeddings for input allocation
-    //4. batch_decode
-    
-    //1-4 now works within llama internal & native. 
+    const FMappedIndexHeader& Header = Private->Mapped->GetHeader();
+    Params.Dimensions = Header.Dimensions;
+    Params.MaxElements = (int32)Header.ElementCount;
+    Params.M = Header.M;
+    Params.EFConstruction = Header.EFConstruction;
+    Params.Metric = (EVectorDBMetric)Header.Metric;
 
-    //5. store embeddings in index.
-    //6. potentially save index
+    //Text is read from the mapping
+    {
+        FScopeLock Lock(&TextDatabaseMutex);
+        TextDatabase.Empty();
+        TextDatabaseMaxId = Header.TextDatabaseMaxId;
+    }
 
-    //we should store and retrieve stored embeddings
-    //What's a good api for VectorDB?
+    UE_LOG(LlamaLog, Log, TEXT("VectorDB mapped %d entries from %s"), Num(), *FullPath);
+    return true;
+}
+
+FVectorDatabase::FVectorDatabase()
+{
+    Private = new FHNSWPrivate();
 }
 
 FVectorDatabase::~FVectorDatabase()
@@ -200,4 +1153,4 @@ FVectorDatabase::~FVectorDatabase()
     TextDatabase.Empty();
     delete Private;
     Private = nullptr;
-}
\ No newline at end of file
+}
@@ -0,0 +1,342 @@
+// Copyright 2025-current Getnamo.
+
+#include "Internal/LlamaAutoTuner.h"
+#include "Internal/LlamaBackend.h"
+#include "Internal/LlamaInternal.h"
+#include "LlamaModelCatalog.h"
+#include "LlamaUtility.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "llama.h"
+
+#include <vector>
+
+FCriticalSection FLlamaAutoTuner::FileMutex;
+
+namespace
+{
+    TSharedPtr<FJsonObject> LoadTuneFile(const FString& Path)
+    {
+        FString JsonString;
+        TSharedPtr<FJsonObject> Root;
+        if (FFileHelper::LoadFileToString(JsonString, *Path))
+        {
+            TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+            FJsonSerializer::Deserialize(Reader, Root);
+        }
+        return Root.IsValid() ? Root : MakeShared<FJsonObject>();
+    }
+}
+
+FString FLlamaAutoTuner::ConfigFilePath()
+{
+    return FPaths::ProjectSavedDir() / TEXT("Config") / TEXT("LlamaAutoTune.json");
+}
+
+FString FLlamaAutoTuner::MakeKey(const FLLMModelParams& Params)
+{
+    const FString Fingerprint = FLlamaModelCatalog::ComputeFingerprint(FLlamaPaths::ParsePathIntoFullPath(Params.PathToModel));
+    return FString::Printf(TEXT("%s | %s | gpu%d"), *FLlamaBackend::GetHardwareSummary(), *Fingerprint, Params.GPULayers);
+}
+
+bool FLlamaAutoTuner::FindCachedResult(const FString& Key, FLlamaTunedParams& OutResult)
+{
+    FScopeLock Lock(&FileMutex);
+
+    TSharedPtr<FJsonObject> Root = LoadTuneFile(ConfigFilePath());
+    const TSharedPtr<FJsonObject>* Entry = nullptr;
+    if (!Root->TryGetObjectField(Key, Entry))
+    {
+        return false;
+    }
+
+    OutResult.Threads = (*Entry)->GetIntegerField(TEXT("Threads"));
+    OutResult.BatchThreads = (*Entry)->GetIntegerField(TEXT("BatchThreads"));
+    OutResult.BatchLength = (*Entry)->GetIntegerField(TEXT("BatchLength"));
+    OutResult.UBatchLength = (*Entry)->GetIntegerField(TEXT("UBatchLength"));
+    OutResult.PrefillSpeed = (*Entry)->GetNumberField(TEXT("PrefillSpeed"));
+    OutResult.DecodeSpeed = (*Entry)->GetNumberField(TEXT("DecodeSpeed"));
+    return OutResult.IsValid();
+}
+
+void FLlamaAutoTuner::SaveResult(const FString& Key, const FLlamaTunedParams& Result)
+{
+    FScopeLock Lock(&FileMutex);
+
+    const FString Path = ConfigFilePath();
+    TSharedPtr<FJsonObject> Root = LoadTuneFile(Path);
+
+    TSharedPtr<FJsonObject> Entry = MakeShared<FJsonObject>();
+    Entry->SetNumberField(TEXT("Threads"), Result.Threads);
+    Entry->SetNumberField(TEXT("BatchThreads"), Result.BatchThreads);
+    Entry->SetNumberField(TEXT("BatchLength"), Result.BatchLength);
+    Entry->SetNumberField(TEXT("UBatchLength"), Result.UBatchLength);
+    Entry->SetNumberField(TEXT("PrefillSpeed"), Result.PrefillSpeed);
+    Entry->SetNumberField(TEXT("DecodeSpeed"), Result.DecodeSpeed);
+    Root->SetObjectField(Key, Entry);
+
+    FString JsonString;
+    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+    FJsonSerializer::Serialize(Root.ToSharedRef(), Writer);
+    FFileHelper::SaveStringToFile(JsonString, *Path);
+}
+
+bool FLlamaAutoTuner::Measure(llama_model* Model, int32 Threads, int32 BatchThreads, int32 BatchLength, int32 UBatchLength,
+    int32 PromptTokens, int32 DecodeTokens, FMeasurement& OutMeasurement, const TFunction<bool()>& ShouldAbort)
+{
+    llama_context_params ContextParams = llama_context_default_params();
+    ContextParams.n_ctx = PromptTokens + DecodeTokens + 16;
+    ContextParams.n_batch = BatchLength;
+    ContextParams.n_ubatch = UBatchLength;
+    ContextParams.n_threads = Threads;
+    ContextParams.n_threads_batch = BatchThreads;
+    ContextParams.no_perf = true;
+
+    llama_context* Context = llama_init_from_model(Model, ContextParams);
+    if (!Context)
+    {
+        return false;
+    }
+
+    //Aborted decodes return non-zero, which ends the measurement as failed
+    if (ShouldAbort)
+    {
+        llama_set_abort_callback(Context, [](void* UserData)
+        {
+            return (*static_cast<const TFunction<bool()>*>(UserData))();
+        }, (void*)&ShouldAbort);
+    }
+
+    //Content doesn't matter for throughput, avoid the first ids which are usually control tokens
+    const llama_vocab* Vocab = llama_model_get_vocab(Model);
+    const int32 NVocab = llama_vocab_n_tokens(Vocab);
+    std::vector<llama_token> Tokens(PromptTokens);
+    for (int32 i = 0; i < PromptTokens; i++)
+    {
+        Tokens[i] = (llama_token)(1000 + (i * 7919) % FMath::Max(NVocab - 1000, 1)) % NVocab;
+    }
+
+    //Untimed pass so allocation and first-touch costs don't skew the first candidate
+    bool bSuccess = llama_decode(Context, llama_batch_get_one(Tokens.data(), FMath::Min(8, PromptTokens))) == 0;
+    llama_memory_clear(llama_get_memory(Context), true);
+    llama_synchronize(Context);
+
+    //Prefill
+    double StartTime = FPlatformTime::Seconds();
+    for (int32 Done = 0; bSuccess && Done < PromptTokens; Done += BatchLength)
+    {
+        const int32 Chunk = FMath::Min(BatchLength, PromptTokens - Done);
+        bSuccess = llama_decode(Context, llama_batch_get_one(Tokens.data() + Done, Chunk)) == 0;
+    }
+    llama_synchronize(Context);
+    const double PrefillTime = FPlatformTime::Seconds() - StartTime;
+
+    //Decode
+    StartTime = FPlatformTime::Seconds();
+    for (int32 i = 0; bSuccess && i < DecodeTokens; i++)
+    {
+        llama_token Token = Tokens[i % PromptTokens];
+        bSuccess = llama_decode(Context, llama_batch_get_one(&Token, 1)) == 0;
+    }
+    llama_synchronize(Context);
+    const double DecodeTime = FPlatformTime::Seconds() - StartTime;
+
+    llama_free(Context);
+
+    if (!bSuccess)
+    {
+        return false;
+    }
+
+    OutMeasurement.PrefillSpeed = PrefillTime > 0.0 ? (float)(PromptTokens / PrefillTime) : 0.f;
+    OutMeasurement.DecodeSpeed = DecodeTime > 0.0 ? (float)(DecodeTokens / DecodeTime) : 0.f;
+    return true;
+}
+
+FLlamaTunedParams FLlamaAutoTuner::Tune(llama_model* Model, const FLLMModelParams& Params, TFunction<bool()> ShouldAbort)
+{
+    const double TuneStart = FPlatformTime::Seconds();
+
+    FLlamaTunedParams Best;
+    if (!Model)
+    {
+        return Best;
+    }
+
+    const int32 PromptTokens = 512;
+    const int32 DecodeTokens = 32;
+
+    //Thread candidates around physical/logical core counts, leaving some headroom for the game
+    const int32 Physical = FMath::Max(FPlatformMisc::NumberOfCores(), 1);
+    const int32 Logical = FMath::Max(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), Physical);
+    TArray<int32> ThreadCandidates;
+    for (int32 Candidate : { Physical / 2, Physical - 2, Physical - 1, Physical, Logical })
+    {
+        if (Candidate >= 1)
+        {
+            ThreadCandidates.AddUnique(Candidate);
+        }
+    }
+    ThreadCandidates.Sort();
+
+    //Pass 1: threads. Decode picks Threads, prefill picks BatchThreads.
+    float BestDecode = 0.f;
+    float BestPrefill = 0.f;
+    for (int32 Threads : ThreadCandidates)
+    {
+        if (ShouldAbort && ShouldAbort())
+        {
+            return FLlamaTunedParams();
+        }
+
+        FMeasurement Measurement;
+        if (!Measure(Model, Threads, Threads, 512, 512, PromptTokens, DecodeTokens, Measurement, ShouldAbort))
+        {
+            continue;
+        }
+
+        UE_LOG(LlamaLog, Log, TEXT("AutoTune threads %d: prefill %.1f tps, decode %.1f tps"), Threads, Measurement.PrefillSpeed, Measurement.DecodeSpeed);
+
+        if (Measurement.DecodeSpeed > BestDecode)
+        {
+            BestDecode = Measurement.DecodeSpeed;
+            Best.Threads = Threads;
+        }
+        if (Measurement.PrefillSpeed > BestPrefill)
+        {
+            BestPrefill = Measurement.PrefillSpeed;
+            Best.BatchThreads = Threads;
+        }
+    }
+
+    if (Best.Threads == 0)
+    {
+        return FLlamaTunedParams();
+    }
+
+    //Pass 2: batch/ubatch for prefill. Within 3% prefer smaller batches, they cancel and interleave sooner.
+    BestPrefill = 0.f;
+    for (int32 BatchLength : { 256, 512, 1024 })
+    {
+        for (int32 UBatchLength : { 128, 256, 512 })
+        {
+            if (UBatchLength > BatchLength)
+            {
+                continue;
+            }
+            if (ShouldAbort && ShouldAbort())
+            {
+                return FLlamaTunedParams();
+            }
+
+            FMeasurement Measurement;
+            if (!Measure(Model, Best.Threads, Best.BatchThreads, BatchLength, UBatchLength, PromptTokens * 2, DecodeTokens, Measurement, ShouldAbort))
+            {
+                continue;
+            }
+
+            UE_LOG(LlamaLog, Log, TEXT("AutoTune batch %d ubatch %d: prefill %.1f tps"), BatchLength, UBatchLength, Measurement.PrefillSpeed);
+
+            if (Measurement.PrefillSpeed > BestPrefill * 1.03f)
+            {
+                BestPrefill = Measurement.PrefillSpeed;
+                Best.BatchLength = BatchLength;
+                Best.UBatchLength = UBatchLength;
+                Best.DecodeSpeed = Measurement.DecodeSpeed;
+            }
+        }
+    }
+    Best.PrefillSpeed = BestPrefill;
+
+    //An abort in the last measurement leaves a partial sweep, don't let it get cached
+    if (ShouldAbort && ShouldAbort())
+    {
+        return FLlamaTunedParams();
+    }
+
+    UE_LOG(LlamaLog, Log, TEXT("AutoTune done in %.1fs: threads %d, batch threads %d, batch %d, ubatch %d (prefill %.1f tps, decode %.1f tps)"),
+        FPlatformTime::Seconds() - TuneStart, Best.Threads, Best.BatchThreads, Best.BatchLength, Best.UBatchLength, Best.PrefillSpeed, Best.DecodeSpeed);
+
+    return Best;
+}
+
+TArray<FLlamaPlacementBenchmark> FLlamaAutoTuner::BenchmarkTensorPlacements(const FLLMModelParams& Params, TFunction<bool()> ShouldAbort)
+{
+    TArray<FLlamaPlacementBenchmark> Results;
+
+    const UEnum* PlacementEnum = StaticEnum<ELlamaTensorPlacement>();
+
+    for (int32 i = 0; i < PlacementEnum->NumEnums() - 1; i++)
+    {
+        FLlamaPlacementBenchmark Result;
+        Result.Placement = (ELlamaTensorPlacement)PlacementEnum->GetValueByIndex(i);
+
+        if (ShouldAbort && ShouldAbort())
+        {
+            Results.Add(Result);
+            continue;
+        }
+
+        FLLMModelParams BenchParams = Params;
+        BenchParams.TensorPlacement = Result.Placement;
+        BenchParams.bAutoTuneHardware = false;
+        BenchParams.bAutoInsertSystemPromptOnLoad = false;
+        BenchParams.bPrefetchModelFile = false;
+        BenchParams.LoraAdapters.Empty();
+        BenchParams.ControlVectors.Empty();
+
+        //Only the weights are measured, Measure makes its own context
+        BenchParams.bWarmupOnLoad = false;
+        BenchParams.Advanced.bCreateEmbeddingContext = false;
+        BenchParams.Advanced.bUseEmbeddingCache = false;
+
+        //Scratch instance, only its model is used. The abort reaches the weight load via its progress callback.
+        FLlamaInternal* BenchInternal = new FLlamaInternal();
+        BenchInternal->SetRequestCancelCheck(ShouldAbort);
+
+        const double LoadStart = FPlatformTime::Seconds();
+        if (BenchInternal->LoadModelFromParams(BenchParams))
+        {
+            Result.LoadTime = (float)(FPlatformTime::Seconds() - LoadStart);
+
+            const int32 BatchThreads = Params.BatchThreads > 0 ? Params.BatchThreads : Params.Threads;
+            const int32 UBatchLength = FMath::Min(Params.MaxUBatchLength, Params.MaxBatchLength);
+
+            FMeasurement Measurement;
+            Result.bValid = Measure(BenchInternal->LlamaModel, Params.Threads, BatchThreads, Params.MaxBatchLength, UBatchLength, 512, 64, Measurement, ShouldAbort);
+            Result.PrefillTokensPerSecond = Measurement.PrefillSpeed;
+            Result.DecodeTokensPerSecond = Measurement.DecodeSpeed;
+        }
+        delete BenchInternal;
+
+        Results.Add(Result);
+    }
+
+    //Report relative to llama defaults
+    const FLlamaPlacementBenchmark& Baseline = Results[0];
+    for (const FLlamaPlacementBenchmark& Result : Results)
+    {
+        const FString Name = PlacementEnum->GetNameStringByValue((int64)Result.Placement);
+        if (!Result.bValid)
+        {
+            UE_LOG(LlamaLog, Log, TEXT("Placement %s: failed to load or run"), *Name);
+            continue;
+        }
+
+        const float DecodeDelta = Baseline.bValid && Baseline.DecodeTokensPerSecond > 0.f ?
+            100.f * (Result.DecodeTokensPerSecond / Baseline.DecodeTokensPerSecond - 1.f) : 0.f;
+        const float PrefillDelta = Baseline.bValid && Baseline.PrefillTokensPerSecond > 0.f ?
+            100.f * (Result.PrefillTokensPerSecond / Baseline.PrefillTokensPerSecond - 1.f) : 0.f;
+
+        UE_LOG(LlamaLog, Log, TEXT("Placement %s: load %.2fs, prefill %.1f tps (%+.1f%%), decode %.1f tps (%+.1f%%)"),
+            *Name, Result.LoadTime, Result.PrefillTokensPerSecond, PrefillDelta, Result.DecodeTokensPerSecond, DecodeDelta);
+    }
+
+    return Results;
+}
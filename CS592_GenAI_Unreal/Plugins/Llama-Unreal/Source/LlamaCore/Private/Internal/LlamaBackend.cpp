@@ -0,0 +1,120 @@
+// Copyright 2025-current Getnamo.
+
+#include "Internal/LlamaBackend.h"
+#include "LlamaUtility.h"
+#include "Misc/ScopeLock.h"
+#include "HardwareInfo.h"
+#include "llama.h"
+#include "ggml-backend.h"
+
+FCriticalSection FLlamaBackend::InitMutex;
+bool FLlamaBackend::bInitialized = false;
+TArray<FLlamaDeviceInfo> FLlamaBackend::Devices;
+FString FLlamaBackend::HardwareSummary;
+
+void FLlamaBackend::Initialize()
+{
+    FScopeLock Lock(&InitMutex);
+
+    if (bInitialized)
+    {
+        return;
+    }
+
+    // only print errors
+    llama_log_set([](enum ggml_log_level level, const char* text, void* /* user_data */)
+    {
+        if (level >= GGML_LOG_LEVEL_ERROR) {
+            fprintf(stderr, "%s", text);
+        }
+    }, nullptr);
+
+    // load dynamic backends
+    ggml_backend_load_all();
+    llama_backend_init();
+
+    //Cache device enumeration
+    Devices.Empty();
+    for (size_t i = 0; i < ggml_backend_dev_count(); i++)
+    {
+        ggml_backend_dev_t Device = ggml_backend_dev_get(i);
+
+        FLlamaDeviceInfo Info;
+        Info.Name = FString(UTF8_TO_TCHAR(ggml_backend_dev_name(Device)));
+        Info.Description = FString(UTF8_TO_TCHAR(ggml_backend_dev_description(Device)));
+
+        switch (ggml_backend_dev_type(Device))
+        {
+        case GGML_BACKEND_DEVICE_TYPE_GPU:
+            Info.Type = ELlamaDeviceType::GPU;
+            break;
+        case GGML_BACKEND_DEVICE_TYPE_IGPU:
+            Info.Type = ELlamaDeviceType::IntegratedGPU;
+            break;
+        case GGML_BACKEND_DEVICE_TYPE_ACCEL:
+            Info.Type = ELlamaDeviceType::Accelerator;
+            break;
+        default:
+            Info.Type = ELlamaDeviceType::CPU;
+            break;
+        }
+
+        size_t Free = 0;
+        size_t Total = 0;
+        ggml_backend_dev_memory(Device, &Free, &Total);
+        Info.MemoryFree = Free;
+        Info.MemoryTotal = Total;
+
+        UE_LOG(LlamaLog, Log, TEXT("Llama backend device: %s (%s) %lluMB free of %lluMB"), *Info.Name, *Info.Description, Info.MemoryFree / (1024 * 1024), Info.MemoryTotal / (1024 * 1024));
+
+        Devices.Add(Info);
+    }
+
+    bInitialized = true;
+}
+
+void FLlamaBackend::Shutdown()
+{
+    FScopeLock Lock(&InitMutex);
+
+    if (!bInitialized)
+    {
+        return;
+    }
+
+    llama_backend_free();
+    Devices.Empty();
+    bInitialized = false;
+}
+
+bool FLlamaBackend::IsInitialized()
+{
+    FScopeLock Lock(&InitMutex);
+    return bInitialized;
+}
+
+TArray<FLlamaDeviceInfo> FLlamaBackend::GetDevices()
+{
+    Initialize();
+
+    FScopeLock Lock(&InitMutex);
+    return Devices;
+}
+
+FString FLlamaBackend::GetHardwareSummary()
+{
+    FScopeLock Lock(&InitMutex);
+
+    //Deferred until first use, RHI details aren't available at module startup
+    if (HardwareSummary.IsEmpty())
+    {
+        FString RHI = FHardwareInfo::GetHardwareDetailsString();
+        FString GPU = FPlatformMisc::GetPrimaryGPUBrand();
+        FString CPU = FPlatformMisc::GetCPUBrand().TrimStartAndEnd();
+
+        HardwareSummary = FString::Printf(TEXT("%s | %s"), *CPU, *GPU);
+
+        UE_LOG(LlamaLog, Log, TEXT("Device Found: %s %s %s"), *CPU, *GPU, *RHI);
+    }
+    return HardwareSummary;
+}
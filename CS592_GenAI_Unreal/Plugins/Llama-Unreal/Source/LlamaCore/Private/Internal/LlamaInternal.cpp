@@ -5,28 +5,19 @@
 #include "common/sampling.h"
 #include "LlamaDataTypes.h"
 #include "LlamaUtility.h"
-#include "HardwareInfo.h"
+#include "Internal/LlamaBackend.h"
+#include "Internal/LlamaAutoTuner.h"
+#include "Embedding/LlamaEmbeddingCache.h"
+#include "LlamaModelCatalog.h"
 
 bool FLlamaInternal::LoadModelFromParams(const FLLMModelParams& InModelParams)
 {
-    FString RHI = FHardwareInfo::GetHardwareDetailsString();
-    FString GPU = FPlatformMisc::GetPrimaryGPUBrand();
-
-    UE_LOG(LogTemp, Log, TEXT("Device Found: %s %s"), *GPU, *RHI);
+    //Global backend state is owned by the module, this is a no-op unless the module hasn't started it yet
+    FLlamaBackend::Initialize();
+    FLlamaBackend::GetHardwareSummary();
 
     LastLoadedParams = InModelParams;
 
-    // only print errors
-    llama_log_set([](enum ggml_log_level level, const char* text, void* /* user_data */) 
-    {
-        if (level >= GGML_LOG_LEVEL_ERROR) {
-            fprintf(stderr, "%s", text);
-        }
-    }, nullptr);
-
-    // load dynamic backends
-    ggml_backend_load_all();
-
     std::string ModelPath = TCHAR_TO_UTF8(*FLlamaPaths::ParsePathIntoFullPath(InModelParams.PathToModel));
 
 
@@ -76,25 +67,97 @@ bool FLlamaInternal::LoadModelFromParams(const FLLMModelParams& InModelParams)
         // initialize the model
         llama_model_params LlamaModelParams = llama_model_default_params();
         LlamaModelParams.n_gpu_layers = InModelParams.GPULayers;
+        LlamaModelParams.use_mmap = InModelParams.bUseMmap;
+        LlamaModelParams.use_mlock = InModelParams.bUseMlock;
+        ApplyTensorPlacement(InModelParams, LlamaModelParams);
+
+        //Warm pages ahead of the loader, mostly helps cold mmapped loads
+        if (InModelParams.bPrefetchModelFile)
+        {
+            FLlamaPaths::PrefetchFileAsync(FLlamaString::ToUE(ModelPath));
+        }
+
+        //Load is cancelled via the progress callback, the caller began the request when it queued the load
+        LastReportedLoadProgress = 0.f;
+        LlamaModelParams.progress_callback = &FLlamaInternal::LoadProgressCallback;
+        LlamaModelParams.progress_callback_user_data = this;
 
         LlamaModel = llama_model_load_from_file(ModelPath.c_str(), LlamaModelParams);
         if (!LlamaModel)
         {
+            if (IsRequestCancelled())
+            {
+                FString ErrorMessage = FString::Printf(TEXT("Model load cancelled for <%hs>"), ModelPath.c_str());
+                EmitErrorMessage(ErrorMessage, 12, __func__);
+                return false;
+            }
             FString ErrorMessage = FString::Printf(TEXT("Unable to load model at <%hs>"), ModelPath.c_str());
             EmitErrorMessage(ErrorMessage, 10, __func__);
             return false;
         }
         
+        int32 Threads = InModelParams.Threads;
+        int32 BatchThreads = InModelParams.BatchThreads > 0 ? InModelParams.BatchThreads : InModelParams.Threads;
+        int32 BatchLength = InModelParams.MaxBatchLength;
+        int32 UBatchLength = FMath::Min(InModelParams.MaxUBatchLength, InModelParams.MaxBatchLength);
+
+        //Measured values for this machine + model replace the hand-set ones
+        if (InModelParams.bAutoTuneHardware && !InModelParams.Advanced.bEmbeddingMode)
+        {
+            FLlamaTunedParams Tuned;
+            const FString TuneKey = FLlamaAutoTuner::MakeKey(InModelParams);
+            if (!FLlamaAutoTuner::FindCachedResult(TuneKey, Tuned))
+            {
+                UE_LOG(LlamaLog, Log, TEXT("No auto-tune entry for this hardware and model, benchmarking..."));
+                Tuned = FLlamaAutoTuner::Tune(LlamaModel, InModelParams, [this]()
+                {
+                    return IsRequestCancelled();
+                });
+                if (Tuned.IsValid())
+                {
+                    FLlamaAutoTuner::SaveResult(TuneKey, Tuned);
+                }
+            }
+
+            if (IsRequestCancelled())
+            {
+                llama_model_free(LlamaModel);
+                LlamaModel = nullptr;
+                FString ErrorMessage = FString::Printf(TEXT("Model load cancelled for <%hs>"), ModelPath.c_str());
+                EmitErrorMessage(ErrorMessage, 12, __func__);
+                return false;
+            }
+
+            if (Tuned.IsValid())
+            {
+                Threads = Tuned.Threads;
+                BatchThreads = Tuned.BatchThreads;
+                BatchLength = Tuned.BatchLength;
+                UBatchLength = Tuned.UBatchLength;
+
+                LastLoadedParams.Threads = Threads;
+                LastLoadedParams.BatchThreads = BatchThreads;
+                LastLoadedParams.MaxBatchLength = BatchLength;
+                LastLoadedParams.MaxUBatchLength = UBatchLength;
+            }
+        }
+
         llama_context_params ContextParams = llama_context_default_params();
         ContextParams.n_ctx = InModelParams.MaxContextLength;
-        ContextParams.n_batch = InModelParams.MaxBatchLength;
-        ContextParams.n_threads = InModelParams.Threads;
-        ContextParams.n_threads_batch = InModelParams.Threads;
+        ContextParams.n_batch = BatchLength;
+        ContextParams.n_ubatch = UBatchLength;
+        ContextParams.n_threads = Threads;
+        ContextParams.n_threads_batch = BatchThreads;
         
         //only set if true
         if (InModelParams.Advanced.bEmbeddingMode)
         {
             ContextParams.embeddings = InModelParams.Advanced.bEmbeddingMode;  //to be tested for A/B comparison if it works
+
+            //Non-causal models need a whole sequence in one ubatch, and batched calls pack many sequences that share the cache
+            ContextParams.n_ubatch = ContextParams.n_batch;
+            ContextParams.n_seq_max = FMath::Clamp(InModelParams.Advanced.EmbeddingMaxSequences, 1, 256);    //256 == LLAMA_MAX_SEQ
+            ContextParams.kv_unified = true;
         }
 
         Context = llama_init_from_model(LlamaModel, ContextParams);
@@ -107,6 +170,39 @@ bool FLlamaInternal::LoadModelFromParams(const FLLMModelParams& InModelParams)
         return false;
     }
 
+    //Allows StopGeneration/UnloadModel to abort in-flight graph compute (NB: llama.cpp currently honors this on CPU backends only)
+    llama_set_abort_callback(Context, &FLlamaInternal::AbortCallback, this);
+
+    //Second context on the same weights, a failure here doesn't fail the chat model
+    if (!InModelParams.Advanced.bEmbeddingMode && InModelParams.Advanced.bCreateEmbeddingContext)
+    {
+        CreateEmbeddingContext(InModelParams);
+    }
+
+    //Pooled vectors only, keyed by everything that changes them
+    if ((InModelParams.Advanced.bEmbeddingMode || EmbeddingContext) && InModelParams.Advanced.bUseEmbeddingCache &&
+        llama_pooling_type(GetEmbeddingContext()) != LLAMA_POOLING_TYPE_NONE)
+    {
+        const FString CacheNamespace = FString::Printf(TEXT("%s|pool%d|norm%d|dim%d"),
+            *FLlamaModelCatalog::ComputeFingerprint(FLlamaString::ToUE(ModelPath)),
+            (int32)llama_pooling_type(GetEmbeddingContext()),
+            InModelParams.Advanced.EmbeddingNormalization,
+            EmbeddingDimensions());
+
+        EmbeddingCache = FLlamaEmbeddingCache::Get(CacheNamespace, EmbeddingDimensions(),
+            InModelParams.Advanced.EmbeddingCacheMemoryEntries, InModelParams.Advanced.bPersistEmbeddingCache);
+    }
+
+    //Adapter failures are reported but don't fail the base model load
+    if (InModelParams.LoraAdapters.Num() > 0)
+    {
+        SetLoraAdapters(InModelParams.LoraAdapters);
+    }
+    if (InModelParams.ControlVectors.Num() > 0)
+    {
+        SetControlVectors(InModelParams.ControlVectors);
+    }
+
     //Only standard mode uses sampling
     if (!InModelParams.Advanced.bEmbeddingMode)
     {
@@ -247,6 +343,21 @@ bool FLlamaInternal::LoadModelFromParams(const FLLMModelParams& InModelParams)
         }
     }
     
+    //Pay the page-fault and lazy allocation cost now instead of on the first real prompt
+    if (InModelParams.bWarmupOnLoad)
+    {
+        WarmupContext(FLlamaString::ToStd(InModelParams.SystemPrompt));
+
+        //Warmup decodes are abortable, a cancel during them cancels the load
+        if (IsRequestCancelled())
+        {
+            UnloadModel();
+            FString ErrorMessage = FString::Printf(TEXT("Model load cancelled for <%hs>"), ModelPath.c_str());
+            EmitErrorMessage(ErrorMessage, 12, __func__);
+            return false;
+        }
+    }
+
     FilledContextCharLength = 0;
 
     bIsModelLoaded = true;
@@ -261,6 +372,22 @@ void FLlamaInternal::UnloadModel()
         llama_sampler_free(Sampler);
         Sampler = nullptr;
     }
+    if (EmbeddingCache)
+    {
+        EmbeddingCache->Flush();
+        EmbeddingCache.Reset();
+    }
+    if (EmbeddingBatchCapacity > 0)
+    {
+        llama_batch_free(EmbeddingBatch);
+        EmbeddingBatch = {};
+        EmbeddingBatchCapacity = 0;
+    }
+    if (EmbeddingContext)
+    {
+        llama_free(EmbeddingContext);
+        EmbeddingContext = nullptr;
+    }
     if (Context)
     {
         llama_free(Context);
@@ -268,9 +395,12 @@ void FLlamaInternal::UnloadModel()
     }
     if (LlamaModel)
     {
+        //frees any loaded adapters as well
         llama_model_free(LlamaModel);
         LlamaModel = nullptr;
     }
+    LoadedLoraAdapters.Empty();
+    LoadedControlVectors.Empty();
     if (CommonSampler)
     {
         common_sampler_free(CommonSampler);
@@ -282,6 +412,179 @@ void FLlamaInternal::UnloadModel()
     bIsModelLoaded = false;
 }
 
+void FLlamaInternal::ApplyTensorPlacement(const FLLMModelParams& InModelParams, llama_model_params& OutModelParams)
+{
+    OutModelParams.use_extra_bufts = InModelParams.bUseExtraBufferTypes;
+
+    TensorOverridePatterns.clear();
+    TensorOverrides.clear();
+
+    switch (InModelParams.TensorPlacement)
+    {
+    case ELlamaTensorPlacement::CPUOptimized:
+        OutModelParams.use_extra_bufts = true;
+        //With offloaded layers the pinned host buffer still speeds up transfers, keep it
+        OutModelParams.no_host = InModelParams.GPULayers == 0;
+        break;
+    case ELlamaTensorPlacement::KeepExpertsOnHost:
+        //same pattern as llama.cpp --cpu-moe
+        TensorOverridePatterns.push_back("\\.ffn_(up|down|gate)_exps");
+        break;
+    default:
+        break;
+    }
+
+    for (const FString& Pattern : InModelParams.CPUTensorOverridePatterns)
+    {
+        TensorOverridePatterns.push_back(FLlamaString::ToStd(Pattern));
+    }
+
+    if (TensorOverridePatterns.empty())
+    {
+        OutModelParams.tensor_buft_overrides = nullptr;
+        return;
+    }
+
+    //Pointers into TensorOverridePatterns, which isn't modified again until the next load
+    for (const std::string& Pattern : TensorOverridePatterns)
+    {
+        TensorOverrides.push_back({ Pattern.c_str(), ggml_backend_cpu_buffer_type() });
+    }
+    TensorOverrides.push_back({ nullptr, nullptr });
+
+    OutModelParams.tensor_buft_overrides = TensorOverrides.data();
+}
+
+llama_adapter_lora* FLlamaInternal::GetOrLoadLoraAdapter(const FString& Path)
+{
+    const FString FullPath = FLlamaPaths::ParsePathIntoFullPath(Path);
+
+    if (llama_adapter_lora** Cached = LoadedLoraAdapters.Find(FullPath))
+    {
+        return *Cached;
+    }
+
+    llama_adapter_lora* Adapter = llama_adapter_lora_init(LlamaModel, FLlamaString::ToStd(FullPath).c_str());
+    if (!Adapter)
+    {
+        FString ErrorMessage = FString::Printf(TEXT("Unable to load LoRA adapter at <%s>"), *FullPath);
+        EmitErrorMessage(ErrorMessage, 13, __func__);
+        return nullptr;
+    }
+
+    LoadedLoraAdapters.Add(FullPath, Adapter);
+    return Adapter;
+}
+
+bool FLlamaInternal::SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters)
+{
+    if (!Context)
+    {
+        return false;
+    }
+
+    //Resolve everything first so a bad path doesn't leave a half applied set
+    TArray<TPair<llama_adapter_lora*, float>> Resolved;
+    for (const FLlamaLoraAdapter& Adapter : Adapters)
+    {
+        llama_adapter_lora* LoadedAdapter = GetOrLoadLoraAdapter(Adapter.Path);
+        if (!LoadedAdapter)
+        {
+            return false;
+        }
+        Resolved.Add(TPair<llama_adapter_lora*, float>(LoadedAdapter, Adapter.Scale));
+    }
+
+    llama_clear_adapter_lora(Context);
+    for (const TPair<llama_adapter_lora*, float>& Pair : Resolved)
+    {
+        if (llama_set_adapter_lora(Context, Pair.Key, Pair.Value) != 0)
+        {
+            EmitErrorMessage(TEXT("Failed to apply LoRA adapter, it may not match the base model."), 14, __func__);
+            llama_clear_adapter_lora(Context);
+            LastLoadedParams.LoraAdapters.Empty();
+            return false;
+        }
+    }
+
+    LastLoadedParams.LoraAdapters = Adapters;
+    return true;
+}
+
+const std::vector<float>* FLlamaInternal::GetOrLoadControlVector(const FString& Path)
+{
+    const FString FullPath = FLlamaPaths::ParsePathIntoFullPath(Path);
+
+    if (const std::vector<float>* Cached = LoadedControlVectors.Find(FullPath))
+    {
+        return Cached;
+    }
+
+    //Load at unit strength, scaling happens per blend
+    common_control_vector_data Loaded = common_control_vector_load({ { 1.f, FLlamaString::ToStd(FullPath) } });
+    if (Loaded.n_embd == -1 || Loaded.n_embd != llama_model_n_embd(LlamaModel))
+    {
+        FString ErrorMessage = FString::Printf(TEXT("Unable to load control vector at <%s>, missing or n_embd doesn't match the model"), *FullPath);
+        EmitErrorMessage(ErrorMessage, 16, __func__);
+        return nullptr;
+    }
+
+    return &LoadedControlVectors.Add(FullPath, MoveTemp(Loaded.data));
+}
+
+bool FLlamaInternal::SetControlVectors(const TArray<FLlamaControlVector>& Vectors)
+{
+    if (!Context)
+    {
+        return false;
+    }
+
+    if (Vectors.Num() == 0)
+    {
+        llama_apply_adapter_cvec(Context, nullptr, 0, 0, 0, 0);
+        LastLoadedParams.ControlVectors.Empty();
+        return true;
+    }
+
+    const int32 NEmbd = llama_model_n_embd(LlamaModel);
+    const int32 NLayer = llama_model_n_layer(LlamaModel);
+
+    //Layer il (1-based) lives at (il - 1) * NEmbd
+    std::vector<float> Blended((size_t)NEmbd * NLayer, 0.f);
+
+    for (const FLlamaControlVector& Vector : Vectors)
+    {
+        const std::vector<float>* Data = GetOrLoadControlVector(Vector.Path);
+        if (!Data)
+        {
+            return false;
+        }
+
+        const int32 VectorLayers = (int32)(Data->size() / NEmbd);
+        const int32 Start = FMath::Max(Vector.LayerStart < 1 ? 1 : Vector.LayerStart, 1);
+        const int32 End = FMath::Min(Vector.LayerEnd < 1 ? NLayer : Vector.LayerEnd, FMath::Min(NLayer, VectorLayers));
+
+        for (int32 Layer = Start; Layer <= End; Layer++)
+        {
+            const size_t Offset = (size_t)(Layer - 1) * NEmbd;
+            for (int32 i = 0; i < NEmbd; i++)
+            {
+                Blended[Offset + i] += Vector.Strength * (*Data)[Offset + i];
+            }
+        }
+    }
+
+    //Layers outside every range are zero, so apply across the whole model
+    if (llama_apply_adapter_cvec(Context, Blended.data(), Blended.size(), NEmbd, 1, NLayer) != 0)
+    {
+        EmitErrorMessage(TEXT("Failed to apply control vector."), 17, __func__);
+        return false;
+    }
+
+    LastLoadedParams.ControlVectors = Vectors;
+    return true;
+}
+
 std::string FLlamaInternal::WrapPromptForRole(const std::string& Text, EChatTemplateRole Role, const std::string& OverrideTemplate, bool bAddAssistantBoS)
 {
     std::vector<llama_chat_message> MessageListWrapper;
@@ -314,6 +617,76 @@ std::string FLlamaInternal::WrapPromptForRole(const std::string& Text, EChatTemp
 void FLlamaInternal::StopGeneration()
 {
     bGenerationActive = false;
+    CancelActiveRequest();
+}
+
+void FLlamaInternal::BeginRequest(int32 QueuedGeneration, int64 RequestId)
+{
+    RequestCancelCheck = nullptr;
+    ActiveGeneration.Set(QueuedGeneration);
+    ActiveRequestId.Set(RequestId);
+}
+
+void FLlamaInternal::BeginRequest()
+{
+    BeginRequest(GetCancelGeneration(), ActiveRequestId.GetValue() + 1);
+}
+
+int32 FLlamaInternal::GetCancelGeneration()
+{
+    return CancelGeneration->GetValue();
+}
+
+void FLlamaInternal::CancelActiveRequest()
+{
+    //If the request finishes first this id is never reused, the next one is unaffected
+    CancelledRequestId.Set(ActiveRequestId.GetValue());
+}
+
+void FLlamaInternal::CancelAllRequests()
+{
+    CancelGeneration->Increment();
+}
+
+bool FLlamaInternal::IsRequestCancelled()
+{
+    return CancelGeneration->GetValue() != ActiveGeneration.GetValue() ||
+        CancelledRequestId.GetValue() == ActiveRequestId.GetValue() ||
+        (RequestCancelCheck && RequestCancelCheck());
+}
+
+void FLlamaInternal::SetRequestCancelCheck(TFunction<bool()> CancelCheck)
+{
+    RequestCancelCheck = MoveTemp(CancelCheck);
+}
+
+void FLlamaInternal::ShareCancelGeneration(const TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe>& Generation)
+{
+    CancelGeneration = Generation;
+    BeginRequest();
+}
+
+bool FLlamaInternal::AbortCallback(void* UserData)
+{
+    FLlamaInternal* Self = static_cast<FLlamaInternal*>(UserData);
+    return Self->bComputeAbortable && Self->IsRequestCancelled();
+}
+
+bool FLlamaInternal::LoadProgressCallback(float Progress, void* UserData)
+{
+    FLlamaInternal* Self = static_cast<FLlamaInternal*>(UserData);
+    if (Self->IsRequestCancelled())
+    {
+        return false;
+    }
+
+    //Called per tensor, only forward percent level changes
+    if (Self->OnModelLoadProgress && (Progress - Self->LastReportedLoadProgress >= 0.01f || Progress >= 1.f))
+    {
+        Self->LastReportedLoadProgress = Progress;
+        Self->OnModelLoadProgress(Progress);
+    }
+    return true;
 }
 
 bool FLlamaInternal::IsGenerating()
@@ -453,6 +826,12 @@ std::string FLlamaInternal::InsertRawPrompt(const std::string& Prompt, bool bGen
 
     int32 TokensProcessed = ProcessPrompt(Prompt);
 
+    //Cancelled or failed, nothing was inserted
+    if (TokensProcessed < 0)
+    {
+        return std::string();
+    }
+
     FLlamaString::AppendToCharVector(ContextHistory, Prompt);
 
     if (bGenerateReply)
@@ -492,6 +871,18 @@ std::string FLlamaInternal::InsertTemplatedPrompt(const std::string& Prompt, ECh
     {
         std::string FormattedPrompt(ContextHistory.data() + FilledContextCharLength, ContextHistory.data() + NewLen);
         int32 TokensProcessed = ProcessPrompt(FormattedPrompt, Role);
+
+        //Nothing was inserted (cancelled, overflow or decode failure), undo the message as well
+        if (TokensProcessed < 0)
+        {
+            if (!Prompt.empty())
+            {
+                free((void*)Messages.back().content);
+                Messages.pop_back();
+            }
+            ContextHistory.resize(FilledContextCharLength);
+            return std::string();
+        }
     }
 
     FilledContextCharLength = NewLen;
@@ -519,146 +910,495 @@ void FLlamaInternal::GetPromptEmbeddings(const std::string& Text, std::vector<fl
 {
     //apply https://github.com/ggml-org/llama.cpp/blob/master/examples/embedding/embedding.cpp wrapping logic
 
-    if (!Context)
+    llama_context* EmbedContext = GetEmbeddingContext();
+    if (!EmbedContext)
     {
         EmitErrorMessage(TEXT("Context invalid, did you load the model?"), 43, __func__);
         return;
     }
 
-    //Tokenize prompt - we're crashing out here... 
-    //Check if our sampling/etc params are wrong or vocab is wrong.
-    //Try tokenizing using normal method?
-    //CONTINUE HERE:
+    //Pooled models share the batched path
+    if (llama_pooling_type(EmbedContext) != LLAMA_POOLING_TYPE_NONE)
+    {
+        int32 Dimensions = 0;
+        GetPromptEmbeddingsBatch({ Text }, Embeddings, Dimensions);
+        return;
+    }
 
-    UE_LOG(LogTemp, Log, TEXT("Trying to sample <%hs>"), Text.c_str());
+    std::vector<llama_token> Input = common_tokenize(EmbedContext, Text, true, true);
 
-    auto Input = common_tokenize(Context, Text, true, true);
+    const int32 NBatch = llama_n_batch(EmbedContext);
+    if ((int32)Input.size() > NBatch)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Embedding input of %d tokens truncated to batch size %d"), (int32)Input.size(), NBatch);
+        Input.resize(NBatch);
+    }
 
-    //int32 NBatch = llama_n_ctx(Context);    //todo: get this from our params
-    int32 NBatch = Input.size();    //todo: get this from our params
+    llama_batch& Batch = GetEmbeddingBatch();
+    BatchAddSeq(Batch, Input, 0);
 
-    llama_batch Batch = llama_batch_init(NBatch, 0, 1);
-    //llama_batch Batch = llama_batch_get_one(Input.data(), Input.size());
+    //Pooling NONE returns one embedding per token
+    const int32 NEmbd = EmbeddingDimensions();
+    Embeddings.assign(Input.size() * NEmbd, 0.f);
 
-    //add single batch
-    BatchAddSeq(Batch, Input, 0);
+    if (!BatchDecodeEmbedding(EmbedContext, Batch, Embeddings.data(), 1, NEmbd, LastLoadedParams.Advanced.EmbeddingNormalization))
+    {
+        Embeddings.clear();
+    }
+}
 
-    enum llama_pooling_type PoolingType = llama_pooling_type(Context);
+bool FLlamaInternal::GetPromptEmbeddingsBatch(const std::vector<std::string>& Texts, std::vector<float>& OutEmbeddings, int32& OutDimensions)
+{
+    llama_context* EmbedContext = GetEmbeddingContext();
+    OutEmbeddings.clear();
+    OutDimensions = 0;
 
-    //Count number of embeddings
-    int32 EmbeddingCount = 0;
-    
-    if (PoolingType == llama_pooling_type::LLAMA_POOLING_TYPE_NONE)
+    if (!EmbedContext)
     {
-        EmbeddingCount = Input.size();
+        EmitErrorMessage(TEXT("Context invalid, did you load the model?"), 43, __func__);
+        return false;
     }
-    else
+    if (llama_pooling_type(EmbedContext) == LLAMA_POOLING_TYPE_NONE)
     {
-        EmbeddingCount = 1;
+        EmitErrorMessage(TEXT("Batched embeddings require a pooled embedding model, pooling type NONE returns per token vectors."), 45, __func__);
+        return false;
+    }
+
+    const int32 NEmbd = EmbeddingDimensions();
+    const int32 NBatch = llama_n_batch(EmbedContext);
+    const int32 NSeqMax = llama_n_seq_max(EmbedContext);
+
+    const int32 Normalization = LastLoadedParams.Advanced.EmbeddingNormalization;
+
+    OutEmbeddings.assign(Texts.size() * NEmbd, 0.f);
+    OutDimensions = NEmbd;
+
+    //LoRA/control vectors only apply to the embedding context in embedding mode, they change the vectors but not the
+    //cache namespace so bypass the cache while any are set
+    const bool bAdaptersApplied = EmbedContext == Context &&
+        (LastLoadedParams.LoraAdapters.Num() > 0 || LastLoadedParams.ControlVectors.Num() > 0);
+    FLlamaEmbeddingCache* Cache = bAdaptersApplied ? nullptr : EmbeddingCache.Get();
+
+    //Cache hits go straight to the output, only misses are decoded
+    std::vector<int32> MissIndices;
+    std::vector<uint64> TextHashes(Texts.size());
+    for (int32 i = 0; i < (int32)Texts.size(); i++)
+    {
+        TextHashes[i] = FLlamaEmbeddingCache::HashText(Texts[i].data(), Texts[i].size());
+        if (!Cache || !Cache->Find(TextHashes[i], OutEmbeddings.data() + (size_t)i * NEmbd))
+        {
+            MissIndices.push_back(i);
+        }
+    }
+
+    if (MissIndices.empty())
+    {
+        return true;
     }
-    
-    int32 NEmbd = llama_model_n_embd(LlamaModel);
 
-    //allocate
-    Embeddings = std::vector<float>(EmbeddingCount * NEmbd, 0);
+    //Queued behind a cancel, skip tokenizing and decoding entirely
+    if (IsRequestCancelled())
+    {
+        EmitErrorMessage(TEXT("Embedding decode cancelled."), 44, __func__);
+        OutEmbeddings.clear();
+        OutDimensions = 0;
+        return false;
+    }
+
+    std::vector<std::vector<llama_token>> Tokenized;
+    std::vector<bool> Truncated;
+    Tokenized.reserve(MissIndices.size());
+    Truncated.reserve(MissIndices.size());
+    for (int32 TextIndex : MissIndices)
+    {
+        std::vector<llama_token> Tokens = common_tokenize(EmbedContext, Texts[TextIndex], true, true);
+        Truncated.push_back((int32)Tokens.size() > NBatch);
+        if (Truncated.back())
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("Embedding input of %d tokens truncated to batch size %d"), (int32)Tokens.size(), NBatch);
+            Tokens.resize(NBatch);
+        }
+        Tokenized.push_back(std::move(Tokens));
+    }
 
-    float* EmbeddingsPtr = Embeddings.data();
+    llama_batch& Batch = GetEmbeddingBatch();
+    std::vector<float> DecodeOutput((size_t)NSeqMax * NEmbd);
 
-    //decode
-    BatchDecodeEmbedding(Context, Batch, EmbeddingsPtr, 0, NEmbd, 2);
+    //Greedy pack in input order, seq_id is the index within the current decode
+    int32 Next = 0;
+    while (Next < (int32)Tokenized.size())
+    {
+        common_batch_clear(Batch);
 
-    UE_LOG(LogTemp, Log, TEXT("Embeddings count: %d"), Embeddings.size());
+        const int32 First = Next;
+        while (Next < (int32)Tokenized.size() &&
+            Next - First < NSeqMax &&
+            Batch.n_tokens + (int32)Tokenized[Next].size() <= NBatch)
+        {
+            BatchAddSeq(Batch, Tokenized[Next], Next - First);
+            Next++;
+        }
+
+        //only empty inputs, nothing to decode
+        if (Batch.n_tokens == 0)
+        {
+            continue;
+        }
+
+        std::fill(DecodeOutput.begin(), DecodeOutput.end(), 0.f);
+        if (!BatchDecodeEmbedding(EmbedContext, Batch, DecodeOutput.data(), Next - First, NEmbd, Normalization))
+        {
+            OutEmbeddings.clear();
+            OutDimensions = 0;
+            return false;
+        }
+
+        //Scatter back to input order and remember
+        for (int32 Seq = 0; Seq < Next - First; Seq++)
+        {
+            const int32 TextIndex = MissIndices[First + Seq];
+            const float* SeqOutput = DecodeOutput.data() + (size_t)Seq * NEmbd;
+            FMemory::Memcpy(OutEmbeddings.data() + (size_t)TextIndex * NEmbd, SeqOutput, NEmbd * sizeof(float));
+
+            //Truncated vectors depend on n_batch, which isn't part of the key
+            if (Cache && !Tokenized[First + Seq].empty() && !Truncated[First + Seq])
+            {
+                Cache->Add(TextHashes[TextIndex], SeqOutput);
+            }
+        }
+    }
+
+    return true;
 }
 
-int32 FLlamaInternal::ProcessPrompt(const std::string& Prompt, EChatTemplateRole Role)
+bool FLlamaInternal::RerankDocuments(const std::string& Query, const std::vector<std::string>& Documents, std::vector<float>& OutScores)
 {
-    const auto StartTime = ggml_time_us();
+    llama_context* EmbedContext = GetEmbeddingContext();
+    OutScores.clear();
 
-    //Grab vocab
-    const llama_vocab* Vocab = llama_model_get_vocab(LlamaModel);
-    const bool IsFirst = llama_memory_seq_pos_max(llama_get_memory(Context), 0) == 0;
+    if (!EmbedContext)
+    {
+        EmitErrorMessage(TEXT("Context invalid, did you load the model?"), 43, __func__);
+        return false;
+    }
+    if (llama_pooling_type(EmbedContext) != LLAMA_POOLING_TYPE_RANK)
+    {
+        EmitErrorMessage(TEXT("Reranking requires a reranker model with rank pooling, load it with bEmbeddingMode."), 47, __func__);
+        return false;
+    }
 
-    // tokenize the prompt
-    const int NPromptTokens = -llama_tokenize(Vocab, Prompt.c_str(), Prompt.size(), NULL, 0, IsFirst, true);
-    std::vector<llama_token> PromptTokens(NPromptTokens);
-    if (llama_tokenize(Vocab, Prompt.c_str(), Prompt.size(), PromptTokens.data(), PromptTokens.size(), IsFirst, true) < 0)
+    const int32 NBatch = llama_n_batch(EmbedContext);
+    const int32 NSeqMax = llama_n_seq_max(EmbedContext);
+
+    OutScores.assign(Documents.size(), 0.f);
+
+    std::vector<std::vector<llama_token>> Tokenized;
+    Tokenized.reserve(Documents.size());
+    for (const std::string& Document : Documents)
     {
-        EmitErrorMessage(TEXT("failed to tokenize the prompt"), 21, __func__);
-        return NPromptTokens;
+        std::vector<llama_token> Tokens = TokenizeRerankPair(EmbedContext, Query, Document);
+        if ((int32)Tokens.size() > NBatch)
+        {
+            UE_LOG(LlamaLog, Warning, TEXT("Rerank pair of %d tokens truncated to batch size %d"), (int32)Tokens.size(), NBatch);
+            Tokens.resize(NBatch);
+        }
+        Tokenized.push_back(std::move(Tokens));
     }
 
-    //All in one batch
-    if (LastLoadedParams.Advanced.PromptProcessingPacingSleep == 0.f)
+    llama_batch& Batch = GetEmbeddingBatch();
+    std::vector<float> DecodeOutput(NSeqMax);
+
+    //Same greedy packing as embeddings, one relevance score per sequence
+    int32 Next = 0;
+    while (Next < (int32)Tokenized.size())
     {
-        // prepare a batch for the prompt
-        llama_batch Batch = llama_batch_get_one(PromptTokens.data(), PromptTokens.size());
+        common_batch_clear(Batch);
 
-        //check sizing before running prompt decode
-        int NContext = llama_n_ctx(Context);
-        int NContextUsed = llama_memory_seq_pos_max(llama_get_memory(Context), 0);
+        const int32 First = Next;
+        while (Next < (int32)Tokenized.size() &&
+            Next - First < NSeqMax &&
+            Batch.n_tokens + (int32)Tokenized[Next].size() <= NBatch)
+        {
+            BatchAddSeq(Batch, Tokenized[Next], Next - First);
+            Next++;
+        }
 
-        if (NContextUsed + NPromptTokens > NContext)
+        if (Batch.n_tokens == 0)
         {
-            EmitErrorMessage(FString::Printf(
-                TEXT("Failed to insert, tried to insert %d tokens to currently used %d tokens which is more than the max %d context size. Try increasing the context size and re-run prompt."),
-                NPromptTokens, NContextUsed, NContext
-            ), 22, __func__);
-            return 0;
+            continue;
         }
 
-        // run it through the decode (input)
-        if (llama_decode(Context, Batch))
+        std::fill(DecodeOutput.begin(), DecodeOutput.end(), 0.f);
+
+        //Scores are logits, never normalize them
+        if (!BatchDecodeEmbedding(EmbedContext, Batch, DecodeOutput.data(), Next - First, 1, -1))
         {
-            EmitErrorMessage(TEXT("Failed to decode, could not find a KV slot for the batch (try reducing the size of the batch or increase the context)."), 23, __func__);
-            return NPromptTokens;
+            OutScores.clear();
+            return false;
+        }
+
+        for (int32 Seq = 0; Seq < Next - First; Seq++)
+        {
+            OutScores[First + Seq] = DecodeOutput[Seq];
         }
     }
-    //Split it and sleep between batches for pacing purposes
-    else
+
+    return true;
+}
+
+bool FLlamaInternal::GetDocumentEmbeddings(const std::string& Text, ELlamaEmbeddingAggregation Aggregation,
+    std::vector<float>& OutChunkEmbeddings, std::vector<int32>& OutTokenStarts, std::vector<int32>& OutTokenCounts,
+    std::vector<std::string>& OutChunkTexts, std::vector<float>& OutDocumentEmbedding, int32& OutDimensions)
+{
+    llama_context* EmbedContext = GetEmbeddingContext();
+    OutChunkEmbeddings.clear();
+    OutTokenStarts.clear();
+    OutTokenCounts.clear();
+    OutChunkTexts.clear();
+    OutDocumentEmbedding.clear();
+    OutDimensions = 0;
+
+    if (!EmbedContext)
     {
-        int32 BatchCount = LastLoadedParams.Advanced.PromptProcessingPacingSplitN;
+        EmitErrorMessage(TEXT("Context invalid, did you load the model?"), 43, __func__);
+        return false;
+    }
 
-        int32 TotalTokens = PromptTokens.size();
-        int32 TokensPerBatch = TotalTokens / BatchCount;
-        int32 Remainder = TotalTokens % BatchCount;
+    const FLLMModelAdvancedParams& Advanced = LastLoadedParams.Advanced;
 
-        int32 StartIndex = 0;
+    //Leave room for special tokens and re-tokenization drift when the chunk text is embedded
+    const int32 NBatch = llama_n_batch(EmbedContext);
+    const int32 WindowTokens = FMath::Max((Advanced.EmbeddingChunkTokens > 0 ? FMath::Min(Advanced.EmbeddingChunkTokens, NBatch) : NBatch) - 8, 16);
+    const int32 Overlap = FMath::Clamp(Advanced.EmbeddingChunkOverlap, 0, WindowTokens / 2);
+    const int32 Stride = WindowTokens - Overlap;
+
+    const std::vector<llama_token> Tokens = common_tokenize(EmbedContext, Text, false, false);
+    const int32 NTokens = (int32)Tokens.size();
+
+    for (int32 Start = 0; Start < NTokens || Start == 0; Start += Stride)
+    {
+        const int32 Count = FMath::Min(WindowTokens, NTokens - Start);
+        const std::vector<llama_token> Window(Tokens.begin() + Start, Tokens.begin() + Start + Count);
 
-        for (int32 i = 0; i < BatchCount; i++)
+        OutTokenStarts.push_back(Start);
+        OutTokenCounts.push_back(Count);
+        OutChunkTexts.push_back(common_detokenize(EmbedContext, Window, false));
+
+        //last window reached the end
+        if (Start + Count >= NTokens)
         {
-            // Calculate how many tokens to put in this batch
-            int32 CurrentBatchSize = TokensPerBatch + (i < Remainder ? 1 : 0);
+            break;
+        }
+    }
 
-            // Slice the relevant tokens for this batch
-            std::vector<llama_token> BatchTokens(
-                PromptTokens.begin() + StartIndex,
-                PromptTokens.begin() + StartIndex + CurrentBatchSize
-            );
+    if (!GetPromptEmbeddingsBatch(OutChunkTexts, OutChunkEmbeddings, OutDimensions))
+    {
+        OutTokenStarts.clear();
+        OutTokenCounts.clear();
+        OutChunkTexts.clear();
+        return false;
+    }
 
-            // Prepare the batch
-            llama_batch Batch = llama_batch_get_one(BatchTokens.data(), BatchTokens.size());
+    if (Aggregation == ELlamaEmbeddingAggregation::PerChunk)
+    {
+        return true;
+    }
+
+    const int32 NChunks = (int32)OutChunkTexts.size();
+    std::vector<float> Pooled(OutDimensions, Aggregation == ELlamaEmbeddingAggregation::Max ? -FLT_MAX : 0.f);
 
-            // Check context before running decode
-            int NContext = llama_n_ctx(Context);
-            int NContextUsed = llama_memory_seq_pos_max(llama_get_memory(Context), 0);
+    for (int32 Chunk = 0; Chunk < NChunks; Chunk++)
+    {
+        const float* ChunkEmbedding = OutChunkEmbeddings.data() + (size_t)Chunk * OutDimensions;
+        const float Weight = (float)OutTokenCounts[Chunk];
 
-            if (NContextUsed + BatchTokens.size() > NContext)
+        for (int32 i = 0; i < OutDimensions; i++)
+        {
+            if (Aggregation == ELlamaEmbeddingAggregation::Max)
             {
-                EmitErrorMessage(FString::Printf(
-                    TEXT("Failed to insert, tried to insert %d tokens to currently used %d tokens which is more than the max %d context size. Try increasing the context size and re-run prompt."),
-                    BatchTokens.size(), NContextUsed, NContext
-                ), 22, __func__);
-                return 0;
+                Pooled[i] = FMath::Max(Pooled[i], ChunkEmbedding[i]);
             }
-
-            // Decode this batch
-            if (llama_decode(Context, Batch))
+            else
             {
-                EmitErrorMessage(TEXT("Failed to decode, could not find a KV slot for the batch (try reducing the size of the batch or increase the context)."), 23, __func__);
-                return BatchTokens.size();
+                Pooled[i] += Weight * ChunkEmbedding[i];
             }
+        }
+    }
 
-            StartIndex += CurrentBatchSize;
+    //Mean scale doesn't matter once normalized, but keep it meaningful when normalization is off
+    if (Aggregation == ELlamaEmbeddingAggregation::Mean && NTokens > 0)
+    {
+        int32 TotalWeight = 0;
+        for (int32 Count : OutTokenCounts)
+        {
+            TotalWeight += Count;
+        }
+        for (float& Value : Pooled)
+        {
+            Value /= (float)TotalWeight;
+        }
+    }
+
+    OutDocumentEmbedding.resize(OutDimensions);
+    common_embd_normalize(Pooled.data(), OutDocumentEmbedding.data(), OutDimensions, Advanced.EmbeddingNormalization);
+    return true;
+}
+
+int32 FLlamaInternal::EmbeddingDimensions()
+{
+    if (!LlamaModel || !(LastLoadedParams.Advanced.bEmbeddingMode || EmbeddingContext))
+    {
+        return 0;
+    }
+
+    const int32 ModelDimensions = llama_model_n_embd(LlamaModel);
+    const int32 OutputDimensions = LastLoadedParams.Advanced.EmbeddingOutputDimensions;
+    return OutputDimensions > 0 ? FMath::Min(OutputDimensions, ModelDimensions) : ModelDimensions;
+}
+
+llama_context* FLlamaInternal::GetEmbeddingContext()
+{
+    return EmbeddingContext ? EmbeddingContext : Context;
+}
+
+bool FLlamaInternal::CreateEmbeddingContext(const FLLMModelParams& InModelParams)
+{
+    const FLLMModelAdvancedParams& Advanced = InModelParams.Advanced;
+
+    llama_context_params ContextParams = llama_context_default_params();
+    ContextParams.embeddings = true;
+    ContextParams.n_ctx = FMath::Max(Advanced.EmbeddingContextLength, 64);
+    ContextParams.n_batch = FMath::Min((int32)ContextParams.n_ctx, InModelParams.MaxBatchLength);
+    ContextParams.n_ubatch = ContextParams.n_batch;
+    ContextParams.n_seq_max = FMath::Clamp(Advanced.EmbeddingMaxSequences, 1, 256);
+    ContextParams.kv_unified = true;
+    ContextParams.n_threads = Advanced.EmbeddingThreads > 0 ? Advanced.EmbeddingThreads : InModelParams.Threads;
+    ContextParams.n_threads_batch = ContextParams.n_threads;
+
+    //Chat models usually carry no pooling metadata, mean pooling gives usable sentence vectors for them
+    char Architecture[128] = {};
+    if (llama_model_meta_val_str(LlamaModel, "general.architecture", Architecture, sizeof(Architecture)) > 0)
+    {
+        char PoolingValue[32] = {};
+        const std::string PoolingKey = std::string(Architecture) + ".pooling_type";
+        if (llama_model_meta_val_str(LlamaModel, PoolingKey.c_str(), PoolingValue, sizeof(PoolingValue)) < 0)
+        {
+            ContextParams.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+        }
+    }
+
+    EmbeddingContext = llama_init_from_model(LlamaModel, ContextParams);
+    if (!EmbeddingContext)
+    {
+        EmitErrorMessage(TEXT("Unable to initialize embedding context on the loaded model."), 46, __func__);
+        return false;
+    }
+
+    llama_set_abort_callback(EmbeddingContext, &FLlamaInternal::AbortCallback, this);
+    return true;
+}
+
+llama_batch& FLlamaInternal::GetEmbeddingBatch()
+{
+    const int32 Capacity = llama_n_batch(GetEmbeddingContext());
+    if (EmbeddingBatchCapacity != Capacity)
+    {
+        if (EmbeddingBatchCapacity > 0)
+        {
+            llama_batch_free(EmbeddingBatch);
+        }
+        EmbeddingBatch = llama_batch_init(Capacity, 0, 1);
+        EmbeddingBatchCapacity = Capacity;
+    }
+
+    common_batch_clear(EmbeddingBatch);
+    return EmbeddingBatch;
+}
+
+int32 FLlamaInternal::ProcessPrompt(const std::string& Prompt, EChatTemplateRole Role)
+{
+    const auto StartTime = ggml_time_us();
+
+    //Grab vocab
+    const llama_vocab* Vocab = llama_model_get_vocab(LlamaModel);
+    const bool IsFirst = llama_memory_seq_pos_max(llama_get_memory(Context), 0) == 0;
+
+    // tokenize the prompt
+    const int NPromptTokens = -llama_tokenize(Vocab, Prompt.c_str(), Prompt.size(), NULL, 0, IsFirst, true);
+    std::vector<llama_token> PromptTokens(NPromptTokens);
+    if (llama_tokenize(Vocab, Prompt.c_str(), Prompt.size(), PromptTokens.data(), PromptTokens.size(), IsFirst, true) < 0)
+    {
+        EmitErrorMessage(TEXT("failed to tokenize the prompt"), 21, __func__);
+        return -1;
+    }
+
+    //check sizing once before running any prompt decode
+    const int32 NContext = llama_n_ctx(Context);
+    const int32 NContextUsed = llama_memory_seq_pos_max(llama_get_memory(Context), 0) + 1;
+
+    if (NContextUsed + NPromptTokens > NContext)
+    {
+        EmitErrorMessage(FString::Printf(
+            TEXT("Failed to insert, tried to insert %d tokens to currently used %d tokens which is more than the max %d context size. Try increasing the context size and re-run prompt."),
+            NPromptTokens, NContextUsed, NContext
+        ), 22, __func__);
+        return -1;
+    }
+
+    //Chunk size is bound by n_batch (llama_decode splits each chunk further into n_ubatch sized passes)
+    int32 ChunkSize = llama_n_batch(Context);
+
+    //Pacing will split the prompt into at least n chunks and sleep between them
+    const bool bPacingEnabled = LastLoadedParams.Advanced.PromptProcessingPacingSleep > 0.f;
+    if (bPacingEnabled && LastLoadedParams.Advanced.PromptProcessingPacingSplitN > 1)
+    {
+        const int32 PacedChunkSize = FMath::DivideAndRoundUp(NPromptTokens, LastLoadedParams.Advanced.PromptProcessingPacingSplitN);
+        ChunkSize = FMath::Clamp(PacedChunkSize, 1, ChunkSize);
+    }
+
+    int32 TokensDone = 0;
+    while (TokensDone < NPromptTokens)
+    {
+        //Cancellation is checked between chunks and mid-compute via the abort callback
+        if (IsRequestCancelled())
+        {
+            //rollback whatever got inserted for this prompt
+            llama_memory_seq_rm(llama_get_memory(Context), 0, NContextUsed, -1);
+            EmitErrorMessage(FString::Printf(TEXT("Prompt processing cancelled after %d of %d tokens."), TokensDone, NPromptTokens), 24, __func__);
+            return -1;
+        }
+
+        const int32 CurrentChunkSize = FMath::Min(ChunkSize, NPromptTokens - TokensDone);
+
+        //Batch is a view into the tokenized prompt, no copy needed
+        llama_batch Batch = llama_batch_get_one(PromptTokens.data() + TokensDone, CurrentChunkSize);
+
+        bComputeAbortable = true;
+        const int32 DecodeResult = llama_decode(Context, Batch);
+        bComputeAbortable = false;
+
+        //Aborted, processed ubatches remain in memory; loop back around to rollback
+        if (DecodeResult == 2)
+        {
+            continue;
+        }
+        if (DecodeResult != 0)
+        {
+            //rollback the partial prompt so KV matches the unchanged history
+            llama_memory_seq_rm(llama_get_memory(Context), 0, NContextUsed, -1);
+            EmitErrorMessage(TEXT("Failed to decode, could not find a KV slot for the batch (try reducing the size of the batch or increase the context)."), 23, __func__);
+            return -1;
+        }
+
+        TokensDone += CurrentChunkSize;
+
+        if (OnPromptProgress)
+        {
+            OnPromptProgress(TokensDone, NPromptTokens);
+        }
+
+        if (bPacingEnabled && TokensDone < NPromptTokens)
+        {
             FPlatformProcess::Sleep(LastLoadedParams.Advanced.PromptProcessingPacingSleep);
         }
     }
@@ -679,11 +1419,18 @@ std::string FLlamaInternal::Generate(const std::string& Prompt, bool bAppendToMe
 {
     const auto StartTime = ggml_time_us();
  
-    bGenerationActive = true;
+    //A stop issued during prompt processing of this request should also prevent the reply
+    bGenerationActive = !IsRequestCancelled();
     
     if (!Prompt.empty())
     {
         int32 TokensProcessed = ProcessPrompt(Prompt);
+
+        //Nothing was inserted, don't reply to a missing prompt
+        if (TokensProcessed < 0)
+        {
+            return std::string();
+        }
     }
 
     std::string Response;
@@ -780,6 +1527,72 @@ std::string FLlamaInternal::Generate(const std::string& Prompt, bool bAppendToMe
     return Response;
 }
 
+void FLlamaInternal::WarmupContext(const std::string& RepresentativePrompt)
+{
+    const auto StartTime = ggml_time_us();
+
+    const llama_vocab* Vocab = llama_model_get_vocab(LlamaModel);
+    const bool bEncoderOnly = llama_model_has_encoder(LlamaModel) && !llama_model_has_decoder(LlamaModel);
+    const int32 MaxWarmupTokens = llama_n_ubatch(Context);
+
+    auto RunPass = [this, bEncoderOnly](std::vector<llama_token>& Tokens)
+    {
+        if (Tokens.empty() || IsRequestCancelled())
+        {
+            return;
+        }
+        llama_batch Batch = llama_batch_get_one(Tokens.data(), Tokens.size());
+        bComputeAbortable = true;
+        if (bEncoderOnly)
+        {
+            llama_encode(Context, Batch);
+        }
+        else
+        {
+            llama_decode(Context, Batch);
+        }
+        bComputeAbortable = false;
+    };
+
+    //Pass 1: warmup mode activates every tensor (incl. all experts) so mmapped weights get paged in
+    std::vector<llama_token> WarmupTokens;
+    const llama_token Bos = llama_vocab_bos(Vocab);
+    const llama_token Eos = llama_vocab_eos(Vocab);
+    if (Bos != LLAMA_TOKEN_NULL)
+    {
+        WarmupTokens.push_back(Bos);
+    }
+    if (Eos != LLAMA_TOKEN_NULL)
+    {
+        WarmupTokens.push_back(Eos);
+    }
+    if (WarmupTokens.empty())
+    {
+        WarmupTokens.push_back(0);
+    }
+
+    llama_set_warmup(Context, true);
+    RunPass(WarmupTokens);
+    llama_set_warmup(Context, false);
+
+    //Pass 2: representative sized batch so prompt-sized compute paths are hot
+    std::vector<llama_token> RepresentativeTokens = common_tokenize(Vocab, RepresentativePrompt, true, true);
+    if ((int32)RepresentativeTokens.size() > MaxWarmupTokens)
+    {
+        RepresentativeTokens.resize(MaxWarmupTokens);
+    }
+    llama_memory_clear(llama_get_memory(Context), true);
+    RunPass(RepresentativeTokens);
+
+    //Leave no trace in the context
+    llama_memory_clear(llama_get_memory(Context), true);
+    llama_synchronize(Context);
+    llama_perf_context_reset(Context);
+
+    const float Duration = (ggml_time_us() - StartTime) / 1000000.0f;
+    UE_LOG(LlamaLog, Log, TEXT("Model warmup finished in %1.2fs"), Duration);
+}
+
 void FLlamaInternal::EmitErrorMessage(const FString& ErrorMessage, int32 ErrorCode, const FString& FunctionName)
 {
     UE_LOG(LlamaLog, Error, TEXT("[%s error %d]: %s"), *FunctionName, ErrorCode,  *ErrorMessage);
@@ -851,8 +1664,9 @@ const char* FLlamaInternal::RoleForEnum(EChatTemplateRole Role)
 }
 
 //from https://github.com/ggml-org/llama.cpp/blob/master/examples/embedding/embedding.cpp
-void FLlamaInternal::BatchDecodeEmbedding(llama_context* InContext, llama_batch& Batch, float* Output, int NSeq, int NEmbd, int EmbdNorm)
+bool FLlamaInternal::BatchDecodeEmbedding(llama_context* InContext, llama_batch& Batch, float* Output, int NSeq, int NEmbd, int EmbdNorm)
 {
+    //NB: NEmbd may be below the model's n_embd, normalizing only the leading NEmbd values is the Matryoshka truncation
     const enum llama_pooling_type pooling_type = llama_pooling_type(InContext);
     const struct llama_model* model = llama_get_model(InContext);
 
@@ -864,10 +1678,14 @@ void FLlamaInternal::BatchDecodeEmbedding(llama_context* InContext, llama_batch&
     //Debug info
     //UE_LOG(LlamaLog, Log, TEXT("%hs: n_tokens = %d, n_seq = %d"), __func__, Batch.n_tokens, NSeq);
 
+    int32 Result = 0;
+    bComputeAbortable = true;
+
     if (llama_model_has_encoder(model) && !llama_model_has_decoder(model))
     {
         // encoder-only model
-        if (llama_encode(InContext, Batch) < 0) 
+        Result = llama_encode(InContext, Batch);
+        if (Result < 0) 
         {
             UE_LOG(LlamaLog, Error, TEXT("%hs : failed to encode"), __func__);
         }
@@ -875,45 +1693,96 @@ void FLlamaInternal::BatchDecodeEmbedding(llama_context* InContext, llama_batch&
     else if (!llama_model_has_encoder(model) && llama_model_has_decoder(model)) 
     {
         // decoder-only model
-        if (llama_decode(InContext, Batch) < 0) 
+        Result = llama_decode(InContext, Batch);
+        if (Result < 0) 
         {
             UE_LOG(LlamaLog, Log, TEXT("%hs : failed to decode"), __func__);
         }
     }
 
-    for (int i = 0; i < Batch.n_tokens; i++) 
+    bComputeAbortable = false;
+
+    if (IsRequestCancelled())
     {
-        if (Batch.logits && !Batch.logits[i]) 
-        {
-            continue;
-        }
+        EmitErrorMessage(TEXT("Embedding decode cancelled."), 44, __func__);
+        return false;
+    }
+    if (Result != 0)
+    {
+        return false;
+    }
 
-        const float* Embd = nullptr;
-        int EmbdPos = 0;
-        
-        if (pooling_type == LLAMA_POOLING_TYPE_NONE) 
+    if (pooling_type == LLAMA_POOLING_TYPE_NONE)
+    {
+        for (int i = 0; i < Batch.n_tokens; i++)
         {
-            // try to get token embeddings
-            Embd = llama_get_embeddings_ith(InContext, i);
-            EmbdPos = i;
+            if (Batch.logits && !Batch.logits[i])
+            {
+                continue;
+            }
+
+            // token embeddings
+            const float* Embd = llama_get_embeddings_ith(InContext, i);
             GGML_ASSERT(Embd != NULL && "failed to get token embeddings");
+            common_embd_normalize(Embd, Output + i * NEmbd, NEmbd, EmbdNorm);
         }
-        else if (Batch.seq_id)
-        {
-            // try to get sequence embeddings - supported only when pooling_type is not NONE
-            Embd = llama_get_embeddings_seq(InContext, Batch.seq_id[i][0]);
-            EmbdPos = Batch.seq_id[i][0];
-            GGML_ASSERT(Embd != NULL && "failed to get sequence embeddings");
-        }
-        else
+    }
+    else
+    {
+        // sequence embeddings, one per seq_id
+        for (int Seq = 0; Seq < NSeq; Seq++)
         {
-            //NB: this generally won't work, we should crash here.
-            Embd = llama_get_embeddings(InContext);
+            const float* Embd = llama_get_embeddings_seq(InContext, Seq);
+            if (!Embd)
+            {
+                //sequence had no tokens, leave zeroed
+                continue;
+            }
+            common_embd_normalize(Embd, Output + Seq * NEmbd, NEmbd, EmbdNorm);
         }
+    }
+    return true;
+}
+
+std::vector<llama_token> FLlamaInternal::TokenizeRerankPair(llama_context* InContext, const std::string& Query, const std::string& Document)
+{
+    //Newer reranker GGUFs (e.g. Qwen3-Reranker) carry their prompt format as a named template
+    const char* RerankTemplate = llama_model_chat_template(LlamaModel, "rerank");
+    if (RerankTemplate != nullptr)
+    {
+        std::string Prompt = RerankTemplate;
+        string_replace_all(Prompt, "{query}", Query);
+        string_replace_all(Prompt, "{document}", Document);
+        return common_tokenize(InContext, Prompt, false, true);
+    }
+
+    const llama_vocab* Vocab = llama_model_get_vocab(LlamaModel);
+    const llama_token Eos = llama_vocab_eos(Vocab) != LLAMA_TOKEN_NULL ? llama_vocab_eos(Vocab) : llama_vocab_sep(Vocab);
+
+    std::vector<llama_token> Tokens;
+    if (llama_vocab_get_add_bos(Vocab))
+    {
+        Tokens.push_back(llama_vocab_bos(Vocab));
+    }
 
-        float* Out = Output + EmbdPos * NEmbd;
-        common_embd_normalize(Embd, Out, NEmbd, EmbdNorm);
+    const std::vector<llama_token> QueryTokens = common_tokenize(InContext, Query, false, false);
+    Tokens.insert(Tokens.end(), QueryTokens.begin(), QueryTokens.end());
+    if (llama_vocab_get_add_eos(Vocab))
+    {
+        Tokens.push_back(Eos);
+    }
+    if (llama_vocab_get_add_sep(Vocab))
+    {
+        Tokens.push_back(llama_vocab_sep(Vocab));
+    }
+
+    const std::vector<llama_token> DocumentTokens = common_tokenize(InContext, Document, false, false);
+    Tokens.insert(Tokens.end(), DocumentTokens.begin(), DocumentTokens.end());
+    if (llama_vocab_get_add_eos(Vocab))
+    {
+        Tokens.push_back(Eos);
     }
+    return Tokens;
 }
 
 void FLlamaInternal::BatchAddSeq(llama_batch& batch, const std::vector<int32_t>& tokens, llama_seq_id seq_id)
@@ -934,5 +1803,4 @@ FLlamaInternal::~FLlamaInternal()
 {
     OnTokenGenerated = nullptr;
     UnloadModel();
-    llama_backend_free();
 }
@@ -34,10 +34,18 @@ ULlamaComponent::ULlamaComponent(const FObjectInitializer &ObjectInitializer)
     {
         OnPromptProcessed.Broadcast(TokensProcessed, Role, Speed);
     };
+    LlamaNative->OnPromptProgress = [this](int32 TokensProcessed, int32 TokensTotal)
+    {
+        OnPromptProgress.Broadcast(TokensProcessed, TokensTotal);
+    };
     LlamaNative->OnError = [this](const FString& ErrorMessage, int32 ErrorCode)
     {
         OnError.Broadcast(ErrorMessage, ErrorCode);
     };
+    LlamaNative->OnModelLoadProgress = [this](float Progress)
+    {
+        OnModelLoadProgress.Broadcast(Progress);
+    };
 
     PrimaryComponentTick.bCanEverTick = true;
     PrimaryComponentTick.bStartWithTickEnabled = true;
@@ -145,11 +153,43 @@ void ULlamaComponent::UnloadModel()
     });
 }
 
+void ULlamaComponent::CancelModelLoad()
+{
+    LlamaNative->CancelModelLoad();
+}
+
+void ULlamaComponent::SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory)
+{
+    //Keep describing the serving model until the swap succeeds
+    LlamaNative->SwapModel(NewParams, bMigrateChatHistory, [this, NewParams](const FString& ModelPath, int32 StatusCode)
+    {
+        if (StatusCode != 0)
+        {
+            return;
+        }
+
+        ModelParams = NewParams;
+        OnModelLoaded.Broadcast(ModelPath);
+    });
+}
+
 bool ULlamaComponent::IsModelLoaded()
 {
     return ModelState.bModelIsLoaded;
 }
 
+void ULlamaComponent::SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters)
+{
+    ModelParams.LoraAdapters = Adapters;
+    LlamaNative->SetLoraAdapters(Adapters);
+}
+
+void ULlamaComponent::SetControlVectors(const TArray<FLlamaControlVector>& Vectors)
+{
+    ModelParams.ControlVectors = Vectors;
+    LlamaNative->SetControlVectors(Vectors);
+}
+
 void ULlamaComponent::ResetContextHistory(bool bKeepSystemPrompt)
 {
     LlamaNative->ResetContextHistory(bKeepSystemPrompt);
@@ -235,9 +275,9 @@ FStructuredChatHistory ULlamaComponent::GetStructuredChatHistory()
 
 void ULlamaComponent::GeneratePromptEmbeddingsForText(const FString& Text)
 {
-    if (!ModelParams.Advanced.bEmbeddingMode)
+    if (!ModelParams.Advanced.bEmbeddingMode && !ModelParams.Advanced.bCreateEmbeddingContext)
     {
-        UE_LOG(LlamaLog, Warning, TEXT("Model is not in embedding mode, cannot generate embeddings."));
+        UE_LOG(LlamaLog, Warning, TEXT("Model is not in embedding mode and has no embedding context, cannot generate embeddings."));
         return;
     }
 
@@ -246,3 +286,45 @@ void ULlamaComponent::GeneratePromptEmbeddingsForText(const FString& Text)
         OnEmbeddings.Broadcast(Embeddings, SourceText);
     });
 }
+
+void ULlamaComponent::GeneratePromptEmbeddingsForTexts(const TArray<FString>& Texts)
+{
+    if (!ModelParams.Advanced.bEmbeddingMode && !ModelParams.Advanced.bCreateEmbeddingContext)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Model is not in embedding mode and has no embedding context, cannot generate embeddings."));
+        return;
+    }
+
+    LlamaNative->GetPromptEmbeddingsBatch(Texts, [this](const TArray<float>& Embeddings, int32 Dimensions, const TArray<FString>& SourceTexts)
+    {
+        OnEmbeddingsBatch.Broadcast(Embeddings, Dimensions, SourceTexts);
+    });
+}
+
+void ULlamaComponent::GeneratePromptEmbeddingsForDocument(const FString& Text, ELlamaEmbeddingAggregation Aggregation)
+{
+    if (!ModelParams.Advanced.bEmbeddingMode && !ModelParams.Advanced.bCreateEmbeddingContext)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Model is not in embedding mode and has no embedding context, cannot generate embeddings."));
+        return;
+    }
+
+    LlamaNative->GetDocumentEmbeddings(Text, Aggregation, [this](const TArray<FLlamaEmbeddingChunk>& Chunks, const TArray<float>& DocumentEmbedding, const FString& SourceText)
+    {
+        OnDocumentEmbeddings.Broadcast(Chunks, DocumentEmbedding, SourceText);
+    });
+}
+
+void ULlamaComponent::RerankDocuments(const FString& Query, const TArray<FString>& Candidates, int32 TopN)
+{
+    if (!ModelParams.Advanced.bEmbeddingMode)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("Model is not in embedding mode, cannot rerank."));
+        return;
+    }
+
+    LlamaNative->RerankDocuments(Query, Candidates, TopN, [this](const TArray<FLlamaRerankResult>& Results, const FString& SourceQuery)
+    {
+        OnRerank.Broadcast(Results, SourceQuery);
+    });
+}
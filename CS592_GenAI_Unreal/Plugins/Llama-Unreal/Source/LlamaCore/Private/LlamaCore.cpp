@@ -1,16 +1,22 @@
 // Copyright 2025-current Getnamo.
 
 #include "LlamaCore.h"
+#include "Internal/LlamaBackend.h"
 
 #define LOCTEXT_NAMESPACE "FLlamaCoreModule"
 
 void FLlamaCoreModule::StartupModule()
 {
 	IModuleInterface::StartupModule();
+
+	//One-time backend discovery shared by all model instances
+	FLlamaBackend::Initialize();
 }
 
 void FLlamaCoreModule::ShutdownModule()
 {
+	FLlamaBackend::Shutdown();
+
 	IModuleInterface::ShutdownModule();
 }
 
@@ -0,0 +1,299 @@
+// Copyright 2025-current Getnamo.
+
+#include "LlamaModelCatalog.h"
+#include "LlamaUtility.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+#include "JsonObjectConverter.h"
+#include "gguf.h"
+#include "ggml.h"
+#include "llama.h"
+
+FCriticalSection FLlamaModelCatalog::CatalogMutex;
+TMap<FString, FLlamaModelInfo> FLlamaModelCatalog::CachedInfos;
+bool FLlamaModelCatalog::bIndexLoaded = false;
+
+namespace
+{
+    FString GGUFString(const gguf_context* Ctx, const char* Key)
+    {
+        const int64_t KeyId = gguf_find_key(Ctx, Key);
+        if (KeyId < 0 || gguf_get_kv_type(Ctx, KeyId) != GGUF_TYPE_STRING)
+        {
+            return FString();
+        }
+        return FLlamaString::ToUE(gguf_get_val_str(Ctx, KeyId));
+    }
+
+    //Integer keys vary in width between converters, accept any of them
+    int64 GGUFInteger(const gguf_context* Ctx, const char* Key, int64 Default = 0)
+    {
+        const int64_t KeyId = gguf_find_key(Ctx, Key);
+        if (KeyId < 0)
+        {
+            return Default;
+        }
+        switch (gguf_get_kv_type(Ctx, KeyId))
+        {
+        case GGUF_TYPE_UINT8:   return gguf_get_val_u8(Ctx, KeyId);
+        case GGUF_TYPE_INT8:    return gguf_get_val_i8(Ctx, KeyId);
+        case GGUF_TYPE_UINT16:  return gguf_get_val_u16(Ctx, KeyId);
+        case GGUF_TYPE_INT16:   return gguf_get_val_i16(Ctx, KeyId);
+        case GGUF_TYPE_UINT32:  return gguf_get_val_u32(Ctx, KeyId);
+        case GGUF_TYPE_INT32:   return gguf_get_val_i32(Ctx, KeyId);
+        case GGUF_TYPE_UINT64:  return (int64)gguf_get_val_u64(Ctx, KeyId);
+        case GGUF_TYPE_INT64:   return gguf_get_val_i64(Ctx, KeyId);
+        default:                return Default;
+        }
+    }
+
+    FString FileTypeName(int64 FileType)
+    {
+        switch (FileType)
+        {
+        case LLAMA_FTYPE_ALL_F32:           return TEXT("F32");
+        case LLAMA_FTYPE_MOSTLY_F16:        return TEXT("F16");
+        case LLAMA_FTYPE_MOSTLY_BF16:       return TEXT("BF16");
+        case LLAMA_FTYPE_MOSTLY_Q4_0:       return TEXT("Q4_0");
+        case LLAMA_FTYPE_MOSTLY_Q4_1:       return TEXT("Q4_1");
+        case LLAMA_FTYPE_MOSTLY_Q5_0:       return TEXT("Q5_0");
+        case LLAMA_FTYPE_MOSTLY_Q5_1:       return TEXT("Q5_1");
+        case LLAMA_FTYPE_MOSTLY_Q8_0:       return TEXT("Q8_0");
+        case LLAMA_FTYPE_MOSTLY_Q2_K:       return TEXT("Q2_K");
+        case LLAMA_FTYPE_MOSTLY_Q2_K_S:     return TEXT("Q2_K_S");
+        case LLAMA_FTYPE_MOSTLY_Q3_K_S:     return TEXT("Q3_K_S");
+        case LLAMA_FTYPE_MOSTLY_Q3_K_M:     return TEXT("Q3_K_M");
+        case LLAMA_FTYPE_MOSTLY_Q3_K_L:     return TEXT("Q3_K_L");
+        case LLAMA_FTYPE_MOSTLY_Q4_K_S:     return TEXT("Q4_K_S");
+        case LLAMA_FTYPE_MOSTLY_Q4_K_M:     return TEXT("Q4_K_M");
+        case LLAMA_FTYPE_MOSTLY_Q5_K_S:     return TEXT("Q5_K_S");
+        case LLAMA_FTYPE_MOSTLY_Q5_K_M:     return TEXT("Q5_K_M");
+        case LLAMA_FTYPE_MOSTLY_Q6_K:       return TEXT("Q6_K");
+        case LLAMA_FTYPE_MOSTLY_IQ1_S:      return TEXT("IQ1_S");
+        case LLAMA_FTYPE_MOSTLY_IQ1_M:      return TEXT("IQ1_M");
+        case LLAMA_FTYPE_MOSTLY_IQ2_XXS:    return TEXT("IQ2_XXS");
+        case LLAMA_FTYPE_MOSTLY_IQ2_XS:     return TEXT("IQ2_XS");
+        case LLAMA_FTYPE_MOSTLY_IQ2_S:      return TEXT("IQ2_S");
+        case LLAMA_FTYPE_MOSTLY_IQ2_M:      return TEXT("IQ2_M");
+        case LLAMA_FTYPE_MOSTLY_IQ3_XXS:    return TEXT("IQ3_XXS");
+        case LLAMA_FTYPE_MOSTLY_IQ3_XS:     return TEXT("IQ3_XS");
+        case LLAMA_FTYPE_MOSTLY_IQ3_S:      return TEXT("IQ3_S");
+        case LLAMA_FTYPE_MOSTLY_IQ3_M:      return TEXT("IQ3_M");
+        case LLAMA_FTYPE_MOSTLY_IQ4_NL:     return TEXT("IQ4_NL");
+        case LLAMA_FTYPE_MOSTLY_IQ4_XS:     return TEXT("IQ4_XS");
+        case LLAMA_FTYPE_MOSTLY_TQ1_0:      return TEXT("TQ1_0");
+        case LLAMA_FTYPE_MOSTLY_TQ2_0:      return TEXT("TQ2_0");
+        case LLAMA_FTYPE_MOSTLY_MXFP4_MOE:  return TEXT("MXFP4_MOE");
+        default:                            return FString::Printf(TEXT("Unknown(%lld)"), FileType);
+        }
+    }
+}
+
+bool FLlamaModelCatalog::ReadModelInfo(const FString& FullPath, FLlamaModelInfo& OutInfo)
+{
+    const std::string PathStd = FLlamaString::ToStd(FullPath);
+
+    //no_alloc: only tensor metadata is created, the data section is never read
+    ggml_context* MetaContext = nullptr;
+    gguf_init_params InitParams;
+    InitParams.no_alloc = true;
+    InitParams.ctx = &MetaContext;
+
+    gguf_context* Ctx = gguf_init_from_file(PathStd.c_str(), InitParams);
+    if (!Ctx)
+    {
+        UE_LOG(LlamaLog, Warning, TEXT("FLlamaModelCatalog: <%s> is not a readable gguf"), *FullPath);
+        return false;
+    }
+
+    IFileManager& FileManager = IFileManager::Get();
+
+    OutInfo = FLlamaModelInfo();
+    OutInfo.Path = FullPath;
+    OutInfo.FileSize = FileManager.FileSize(*FullPath);
+    OutInfo.ModifiedTime = FileManager.GetTimeStamp(*FullPath);
+
+    OutInfo.Architecture = GGUFString(Ctx, "general.architecture");
+    OutInfo.Name = GGUFString(Ctx, "general.name");
+    if (OutInfo.Name.IsEmpty())
+    {
+        OutInfo.Name = FPaths::GetBaseFilename(FullPath);
+    }
+    OutInfo.QuantizationType = FileTypeName(GGUFInteger(Ctx, "general.file_type", LLAMA_FTYPE_GUESSED));
+    OutInfo.ChatTemplate = GGUFString(Ctx, "tokenizer.chat_template");
+
+    //Hyperparameters are namespaced by architecture
+    const std::string Arch = FLlamaString::ToStd(OutInfo.Architecture);
+    OutInfo.ContextLengthTrained = (int32)GGUFInteger(Ctx, (Arch + ".context_length").c_str());
+    OutInfo.EmbeddingDimensions = (int32)GGUFInteger(Ctx, (Arch + ".embedding_length").c_str());
+    OutInfo.LayerCount = (int32)GGUFInteger(Ctx, (Arch + ".block_count").c_str());
+    OutInfo.PoolingType = (int32)GGUFInteger(Ctx, (Arch + ".pooling_type").c_str(), -1);
+
+    if (MetaContext)
+    {
+        for (ggml_tensor* Tensor = ggml_get_first_tensor(MetaContext); Tensor; Tensor = ggml_get_next_tensor(MetaContext, Tensor))
+        {
+            OutInfo.ParameterCount += ggml_nelements(Tensor);
+        }
+        ggml_free(MetaContext);
+    }
+    gguf_free(Ctx);
+
+    OutInfo.Fingerprint = ComputeFingerprint(FullPath);
+
+    return true;
+}
+
+FString FLlamaModelCatalog::ComputeFingerprint(const FString& FullPath)
+{
+    TUniquePtr<IFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FullPath));
+    if (!Handle)
+    {
+        return FString();
+    }
+
+    const int64 FileSize = Handle->Size();
+    const int64 SampleSize = FMath::Min<int64>(1024 * 1024, FileSize);
+
+    TArray<uint8> Buffer;
+    Buffer.SetNumUninitialized(SampleSize);
+
+    FMD5 Md5;
+    Md5.Update(reinterpret_cast<const uint8*>(&FileSize), sizeof(FileSize));
+
+    //Header (metadata + tensor table) and the tail of the weights
+    if (Handle->Read(Buffer.GetData(), SampleSize))
+    {
+        Md5.Update(Buffer.GetData(), SampleSize);
+    }
+    if (FileSize > SampleSize && Handle->Seek(FileSize - SampleSize) && Handle->Read(Buffer.GetData(), SampleSize))
+    {
+        Md5.Update(Buffer.GetData(), SampleSize);
+    }
+
+    uint8 Digest[16];
+    Md5.Final(Digest);
+    return BytesToHex(Digest, 16);
+}
+
+FString FLlamaModelCatalog::IndexFilePath()
+{
+    return FLlamaPaths::ModelsRelativeRootPath() / TEXT("ModelCatalog.json");
+}
+
+bool FLlamaModelCatalog::IsCachedInfoValid(const FLlamaModelInfo& Info)
+{
+    IFileManager& FileManager = IFileManager::Get();
+    return FileManager.FileSize(*Info.Path) == Info.FileSize && FileManager.GetTimeStamp(*Info.Path) == Info.ModifiedTime;
+}
+
+void FLlamaModelCatalog::LoadIndexIfNeeded()
+{
+    if (bIndexLoaded)
+    {
+        return;
+    }
+    bIndexLoaded = true;
+
+    FString JsonString;
+    if (!FFileHelper::LoadFileToString(JsonString, *IndexFilePath()))
+    {
+        return;
+    }
+
+    FLlamaModelCatalogIndex Index;
+    if (FJsonObjectConverter::JsonObjectStringToUStruct(JsonString, &Index, 0, 0))
+    {
+        for (const FLlamaModelInfo& Info : Index.Models)
+        {
+            CachedInfos.Add(Info.Path, Info);
+        }
+    }
+}
+
+void FLlamaModelCatalog::SaveIndex()
+{
+    FLlamaModelCatalogIndex Index;
+    CachedInfos.GenerateValueArray(Index.Models);
+
+    FString JsonString;
+    if (FJsonObjectConverter::UStructToJsonObjectString(Index, JsonString))
+    {
+        FFileHelper::SaveStringToFile(JsonString, *IndexFilePath());
+    }
+}
+
+TArray<FLlamaModelInfo> FLlamaModelCatalog::ScanModels(bool bForceRescan)
+{
+    FScopeLock Lock(&CatalogMutex);
+
+    LoadIndexIfNeeded();
+
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *FLlamaPaths::ModelsRelativeRootPath(), TEXT("*.gguf"), true, false);
+
+    TArray<FLlamaModelInfo> Results;
+    TMap<FString, FLlamaModelInfo> UpdatedInfos;
+    bool bIndexChanged = false;
+
+    for (const FString& File : Files)
+    {
+        const FString FullPath = FPaths::ConvertRelativePathToFull(File);
+
+        const FLlamaModelInfo* Cached = CachedInfos.Find(FullPath);
+        if (Cached && !bForceRescan && IsCachedInfoValid(*Cached))
+        {
+            UpdatedInfos.Add(FullPath, *Cached);
+            Results.Add(*Cached);
+            continue;
+        }
+
+        FLlamaModelInfo Info;
+        if (ReadModelInfo(FullPath, Info))
+        {
+            UpdatedInfos.Add(FullPath, Info);
+            Results.Add(Info);
+        }
+        bIndexChanged = true;
+    }
+
+    //Drop entries for files that were removed
+    bIndexChanged |= UpdatedInfos.Num() != CachedInfos.Num();
+    CachedInfos = MoveTemp(UpdatedInfos);
+
+    if (bIndexChanged)
+    {
+        SaveIndex();
+    }
+
+    return Results;
+}
+
+bool FLlamaModelCatalog::FindModelInfo(const FString& RelativeOrAbsolutePath, FLlamaModelInfo& OutInfo)
+{
+    const FString FullPath = FLlamaPaths::ParsePathIntoFullPath(RelativeOrAbsolutePath);
+
+    FScopeLock Lock(&CatalogMutex);
+
+    LoadIndexIfNeeded();
+
+    const FLlamaModelInfo* Cached = CachedInfos.Find(FullPath);
+    if (Cached && IsCachedInfoValid(*Cached))
+    {
+        OutInfo = *Cached;
+        return true;
+    }
+
+    if (!ReadModelInfo(FullPath, OutInfo))
+    {
+        return false;
+    }
+
+    CachedInfos.Add(FullPath, OutInfo);
+    SaveIndex();
+    return true;
+}
@@ -0,0 +1,353 @@
+// Copyright 2025-current Getnamo.
+
+#include "LlamaModelPool.h"
+#include "LlamaNative.h"
+#include "LlamaModelCatalog.h"
+#include "LlamaUtility.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/PackageName.h"
+
+FLlamaModelPool::FLlamaModelPool()
+{
+}
+
+FLlamaModelPool::~FLlamaModelPool()
+{
+	for (TPair<FName, FPooledModel>& Pair : Models)
+	{
+		delete Pair.Value.Native;
+		Pair.Value.Native = nullptr;
+	}
+	Models.Empty();
+}
+
+int64 FLlamaModelPool::EstimateModelBytes(const FLLMModelParams& Params)
+{
+	FLlamaModelInfo Info;
+	if (!FLlamaModelCatalog::FindModelInfo(Params.PathToModel, Info))
+	{
+		return 0;
+	}
+
+	//Upper bound, GQA models use less for KV
+	const int64 KVBytes = 2 * (int64)Info.LayerCount * (int64)Params.MaxContextLength * (int64)Info.EmbeddingDimensions * sizeof(uint16);
+	return Info.FileSize + KVBytes;
+}
+
+void FLlamaModelPool::BindNativeCallbacks(FName ModelName, FLlamaNative* Native)
+{
+	Native->OnTokenGenerated = [this, ModelName](const FString& Token)
+	{
+		if (OnTokenGenerated)
+		{
+			OnTokenGenerated(ModelName, Token);
+		}
+	};
+	Native->OnPartialGenerated = [this, ModelName](const FString& Partial)
+	{
+		if (OnPartialGenerated)
+		{
+			OnPartialGenerated(ModelName, Partial);
+		}
+	};
+	Native->OnError = [this, ModelName](const FString& ErrorMessage, int32 ErrorCode)
+	{
+		if (OnError)
+		{
+			OnError(ModelName, ErrorMessage, ErrorCode);
+		}
+	};
+}
+
+void FLlamaModelPool::RegisterModel(FName ModelName, const FLLMModelParams& Params)
+{
+	FPooledModel& Model = Models.FindOrAdd(ModelName);
+	Model.Params = Params;
+	Model.EstimatedBytes = EstimateModelBytes(Params);
+
+	if (!Model.Native)
+	{
+		Model.Native = new FLlamaNative();
+		Model.Native->AddTicker();
+		BindNativeCallbacks(ModelName, Model.Native);
+	}
+	Model.Native->SetModelParams(Params);
+}
+
+void FLlamaModelPool::UnregisterModel(FName ModelName)
+{
+	FPooledModel* Model = Models.Find(ModelName);
+	if (!Model)
+	{
+		return;
+	}
+
+	//Native destructor stops generation and waits for the BG thread
+	delete Model->Native;
+	Models.Remove(ModelName);
+}
+
+bool FLlamaModelPool::IsModelRegistered(FName ModelName) const
+{
+	return Models.Contains(ModelName);
+}
+
+bool FLlamaModelPool::IsModelResident(FName ModelName) const
+{
+	const FPooledModel* Model = Models.Find(ModelName);
+	return Model && Model->bResident;
+}
+
+bool FLlamaModelPool::IsModelBusy(const FPooledModel& Model) const
+{
+	return Model.bLoading || Model.ActiveRequests > 0 || Model.Native->IsGenerating();
+}
+
+int64 FLlamaModelPool::GetResidentBytes() const
+{
+	int64 Total = 0;
+	for (const TPair<FName, FPooledModel>& Pair : Models)
+	{
+		if (Pair.Value.bResident)
+		{
+			Total += Pair.Value.EstimatedBytes;
+		}
+	}
+	return Total;
+}
+
+TArray<FName> FLlamaModelPool::GetResidentModels() const
+{
+	TArray<FName> Resident;
+	for (const TPair<FName, FPooledModel>& Pair : Models)
+	{
+		if (Pair.Value.bResident)
+		{
+			Resident.Add(Pair.Key);
+		}
+	}
+	return Resident;
+}
+
+bool FLlamaModelPool::EvictToFit(int64 IncomingBytes, FName ExcludeModel, bool bDryRun)
+{
+	if (MemoryBudgetBytes <= 0)
+	{
+		return true;
+	}
+
+	//Oldest first
+	TArray<FName> Candidates;
+	for (const TPair<FName, FPooledModel>& Pair : Models)
+	{
+		if (Pair.Value.bResident && Pair.Key != ExcludeModel && !IsModelBusy(Pair.Value))
+		{
+			Candidates.Add(Pair.Key);
+		}
+	}
+	Candidates.Sort([this](const FName& A, const FName& B)
+	{
+		return Models[A].LastUsedTime < Models[B].LastUsedTime;
+	});
+
+	int64 ResidentBytes = GetResidentBytes();
+	int32 EvictCount = 0;
+	while (ResidentBytes + IncomingBytes > MemoryBudgetBytes && EvictCount < Candidates.Num())
+	{
+		ResidentBytes -= Models[Candidates[EvictCount]].EstimatedBytes;
+		EvictCount++;
+	}
+
+	const bool bFits = ResidentBytes + IncomingBytes <= MemoryBudgetBytes;
+	if (bDryRun || !bFits)
+	{
+		return bFits;
+	}
+
+	for (int32 i = 0; i < EvictCount; i++)
+	{
+		EvictModel(Candidates[i], Models[Candidates[i]]);
+	}
+	return true;
+}
+
+void FLlamaModelPool::EvictModel(FName ModelName, FPooledModel& Model)
+{
+	UE_LOG(LlamaLog, Log, TEXT("Model pool evicting <%s> (%lld MB)"), *ModelName.ToString(), Model.EstimatedBytes / (1024 * 1024));
+
+	Model.bResident = false;
+	Model.Native->UnloadModel();
+
+	if (OnModelEvicted)
+	{
+		OnModelEvicted(ModelName);
+	}
+}
+
+void FLlamaModelPool::LoadIfNeeded(FName ModelName, FPooledModel& Model)
+{
+	if (Model.bResident)
+	{
+		return;
+	}
+
+	//Over budget with nothing idle to evict: load anyway, the caller asked for this model explicitly
+	if (!EvictToFit(Model.EstimatedBytes, ModelName))
+	{
+		UE_LOG(LlamaLog, Warning, TEXT("Model pool: loading <%s> exceeds budget, all resident models are busy."), *ModelName.ToString());
+	}
+
+	Model.bResident = true;
+	Model.bLoading = true;
+	Model.Native->LoadModel(false, [this, ModelName](const FString& ModelPath, int32 StatusCode)
+	{
+		FPooledModel* LoadedModel = Models.Find(ModelName);
+		if (!LoadedModel)
+		{
+			return;
+		}
+		LoadedModel->bLoading = false;
+
+		if (StatusCode != 0)
+		{
+			LoadedModel->bResident = false;
+			return;
+		}
+
+		//Unloaded while the load was in flight, it's on its way out
+		if (!LoadedModel->bResident)
+		{
+			return;
+		}
+
+		if (OnModelLoaded)
+		{
+			OnModelLoaded(ModelName);
+		}
+	});
+}
+
+FLlamaNative* FLlamaModelPool::AcquireModel(FName ModelName)
+{
+	FPooledModel* Model = Models.Find(ModelName);
+	if (!Model)
+	{
+		UE_LOG(LlamaLog, Warning, TEXT("Model pool: <%s> is not registered."), *ModelName.ToString());
+		return nullptr;
+	}
+
+	Model->LastUsedTime = FPlatformTime::Seconds();
+	LoadIfNeeded(ModelName, *Model);
+	return Model->Native;
+}
+
+void FLlamaModelPool::PrewarmModel(FName ModelName)
+{
+	FPooledModel* Model = Models.Find(ModelName);
+	if (!Model || Model->bResident)
+	{
+		return;
+	}
+
+	//Speculative, don't push the pool over budget for it
+	if (!EvictToFit(Model->EstimatedBytes, ModelName, true))
+	{
+		Model->Native->PrefetchModelFile();
+		return;
+	}
+
+	Model->LastUsedTime = FPlatformTime::Seconds();
+	LoadIfNeeded(ModelName, *Model);
+}
+
+void FLlamaModelPool::UnloadModel(FName ModelName)
+{
+	FPooledModel* Model = Models.Find(ModelName);
+	if (Model && Model->bResident)
+	{
+		EvictModel(ModelName, *Model);
+	}
+}
+
+void FLlamaModelPool::InsertTemplatedPrompt(FName ModelName, const FLlamaChatPrompt& Prompt)
+{
+	FLlamaNative* Native = AcquireModel(ModelName);
+	if (!Native)
+	{
+		return;
+	}
+
+	if (!Prompt.bGenerateReply)
+	{
+		Native->InsertTemplatedPrompt(Prompt);
+		return;
+	}
+
+	Models[ModelName].ActiveRequests++;
+	Native->InsertTemplatedPrompt(Prompt, [this, ModelName](const FString& Response)
+	{
+		if (FPooledModel* Model = Models.Find(ModelName))
+		{
+			Model->ActiveRequests--;
+			Model->LastUsedTime = FPlatformTime::Seconds();
+		}
+		if (OnResponseGenerated)
+		{
+			OnResponseGenerated(ModelName, Response);
+		}
+	});
+}
+
+void FLlamaModelPool::GetPromptEmbeddings(FName ModelName, const FString& Text)
+{
+	FLlamaNative* Native = AcquireModel(ModelName);
+	if (!Native)
+	{
+		return;
+	}
+
+	Models[ModelName].ActiveRequests++;
+	Native->GetPromptEmbeddings(Text, [this, ModelName](const TArray<float>& Embeddings, const FString& SourceText)
+	{
+		if (FPooledModel* Model = Models.Find(ModelName))
+		{
+			Model->ActiveRequests--;
+			Model->LastUsedTime = FPlatformTime::Seconds();
+		}
+		if (OnEmbeddings)
+		{
+			OnEmbeddings(ModelName, Embeddings, SourceText);
+		}
+	});
+}
+
+void FLlamaModelPool::StopGeneration(FName ModelName)
+{
+	if (FPooledModel* Model = Models.Find(ModelName))
+	{
+		Model->Native->StopGeneration();
+	}
+}
+
+void FLlamaModelPool::AddMapPrewarmHint(FName MapName, FName ModelName)
+{
+	MapPrewarmHints.AddUnique(MapName, ModelName);
+}
+
+void FLlamaModelPool::RemoveMapPrewarmHints(FName MapName)
+{
+	MapPrewarmHints.Remove(MapName);
+}
+
+void FLlamaModelPool::NotifyMapLoading(const FString& MapOrPackageName)
+{
+	const FName MapName = FName(*FPackageName::GetShortName(MapOrPackageName));
+
+	TArray<FName> HintedModels;
+	MapPrewarmHints.MultiFind(MapName, HintedModels);
+
+	for (const FName& ModelName : HintedModels)
+	{
+		PrewarmModel(ModelName);
+	}
+}
@@ -3,6 +3,8 @@
 #include "LlamaNative.h"
 #include "LlamaUtility.h"
 #include "Internal/LlamaInternal.h"
+#include "Internal/LlamaAutoTuner.h"
+#include "Embedding/LlamaEmbeddingBenchmark.h"
 #include "Async/TaskGraphInterfaces.h"
 #include "Async/Async.h"
 #include "Tickable.h"
@@ -10,9 +12,14 @@
 FLlamaNative::FLlamaNative()
 {
     Internal = new FLlamaInternal();
+    Internal->ShareCancelGeneration(RequestCancelGeneration);
+    BindInternalCallbacks(Internal);
+}
 
-    //Hookup internal listeners - these get called on BG thread
-    Internal->OnTokenGenerated = [this](const std::string& TokenPiece)
+void FLlamaNative::BindInternalCallbacks(FLlamaInternal* Target)
+{
+    //Hookup internal listeners - these get called on BG thread (or the loader thread for pending loads)
+    Target->OnTokenGenerated = [this](const std::string& TokenPiece)
     {
         const FString Token = FLlamaString::ToUE(TokenPiece);
 
@@ -60,7 +67,7 @@ FLlamaNative::FLlamaNative()
         }
     };
 
-    Internal->OnGenerationComplete = [this](const std::string& Response, float Duration, int32 TokensGenerated, float SpeedTps)
+    Target->OnGenerationComplete = [this](const std::string& Response, float Duration, int32 TokensGenerated, float SpeedTps)
     {
         if (ModelParams.Advanced.bLogGenerationStats)
         {
@@ -104,7 +111,7 @@ FLlamaNative::FLlamaNative()
         });
     };
 
-    Internal->OnPromptProcessed = [this](int32 TokensProcessed, EChatTemplateRole RoleProcessed, float SpeedTps)
+    Target->OnPromptProcessed = [this](int32 TokensProcessed, EChatTemplateRole RoleProcessed, float SpeedTps)
     {
         if (ModelParams.Advanced.bLogGenerationStats)
         {
@@ -130,7 +137,29 @@ FLlamaNative::FLlamaNative()
         });
     };
 
-    Internal->OnError = [this](const FString& ErrorMessage, int32 ErrorCode)
+    Target->OnPromptProgress = [this](int32 TokensDone, int32 TokensTotal)
+    {
+        EnqueueGTTask([this, TokensDone, TokensTotal]
+        {
+            if (OnPromptProgress)
+            {
+                OnPromptProgress(TokensDone, TokensTotal);
+            }
+        });
+    };
+
+    Target->OnModelLoadProgress = [this](float Progress)
+    {
+        EnqueueGTTask([this, Progress]
+        {
+            if (OnModelLoadProgress)
+            {
+                OnModelLoadProgress(Progress);
+            }
+        });
+    };
+
+    Target->OnError = [this](const FString& ErrorMessage, int32 ErrorCode)
     {
         const FString ErrorMessageGTSafe = ErrorMessage;
         EnqueueGTTask([this, ErrorMessageGTSafe, ErrorCode]
@@ -145,7 +174,20 @@ FLlamaNative::FLlamaNative()
 
 FLlamaNative::~FLlamaNative()
 {
+    //No background load may start from here on
+    {
+        FScopeLock Lock(&PendingLoadMutex);
+        bBackgroundLoadsBlocked = true;
+    }
     StopGeneration();
+    CancelModelLoad();
+
+    //Loader threads capture this. Load, auto-tune, warmup and replay all check the cancel, so this only waits for the current step to bail
+    while (ActiveLoaderThreads.GetValue() > 0)
+    {
+        FPlatformProcess::Sleep(0.01f);
+    }
+
     bThreadShouldRun = false;
     
     //Remove ticker if active
@@ -156,6 +198,19 @@ FLlamaNative::~FLlamaNative()
     {
         FPlatformProcess::Sleep(0.01f);
     }
+
+    //Anything that didn't make it through the swap/retire round trip
+    if (PendingInternal)
+    {
+        delete PendingInternal;
+        PendingInternal = nullptr;
+    }
+    for (FLlamaInternal* Retired : RetiredInternals)
+    {
+        delete Retired;
+    }
+    RetiredInternals.Empty();
+
     delete Internal;
 }
 
@@ -223,6 +278,9 @@ void FLlamaNative::StartLLMThread()
                 BackgroundTasks.Dequeue(Task);
                 if (Task.TaskFunction)
                 {
+                    //Sweeps issued since the enqueue apply to this task, StopGeneration targets it by id
+                    Internal->BeginRequest(Task.CancelGeneration, Task.TaskId);
+
                     //Run Task
                     Task.TaskFunction(Task.TaskId);
                 }
@@ -251,6 +309,7 @@ void FLlamaNative::EnqueueBGTask(TFunction<void(int64)> TaskFunction)
 
     FLLMThreadTask Task;
     Task.TaskId = GetNextTaskId();
+    Task.CancelGeneration = RequestCancelGeneration->GetValue();
     Task.TaskFunction = TaskFunction;
 
     BackgroundTasks.Enqueue(Task);
@@ -289,11 +348,18 @@ void FLlamaNative::LoadModel(bool bForceReload, TFunction<void(const FString&, i
         //already loaded, we're done
         return ModelLoadedCallback(ModelParams.PathToModel, 0);
     }
-    bModelLoadInitiated = true;
 
     //Copy so these dont get modified during enqueue op
     const FLLMModelParams ParamsAtLoad = ModelParams;
 
+    //Keep serving the current model from the BG thread while the new one loads on its own thread
+    if (ParamsAtLoad.bKeepPreviousModelWhileLoading && IsModelLoaded())
+    {
+        LoadModelInBackground(ParamsAtLoad, ModelLoadedCallback);
+        return;
+    }
+    bModelLoadInitiated = true;
+
     EnqueueBGTask([this, ParamsAtLoad, ModelLoadedCallback](int64 TaskId)
     {
         //Unload first if any is loaded
@@ -302,62 +368,342 @@ void FLlamaNative::LoadModel(bool bForceReload, TFunction<void(const FString&, i
         //Now load it
         bool bSuccess = Internal->LoadModelFromParams(ParamsAtLoad);
 
-        //Sync model state
-        if (bSuccess)
+        FinalizeModelLoad(bSuccess, ParamsAtLoad, ModelLoadedCallback, TaskId);
+    });
+}
+
+void FLlamaNative::CancelModelLoad()
+{
+    CancelPendingLoad();
+
+    //Cancel token is checked in the llama load progress callback
+    if (bModelLoadInitiated)
+    {
+        Internal->CancelAllRequests();
+    }
+}
+
+void FLlamaNative::CancelPendingLoad()
+{
+    TSharedPtr<FBackgroundLoad> Dropped;
+    {
+        //Only the background load, the serving internal keeps its request
+        FScopeLock Lock(&PendingLoadMutex);
+        if (PendingInternal)
         {
-            const FString TemplateString = FLlamaString::ToUE(Internal->Template);
-            const FString TemplateSource = FLlamaString::ToUE(Internal->TemplateSource);
+            PendingInternal->CancelAllRequests();
+        }
+        Dropped = QueuedLoad;
+        QueuedLoad.Reset();
+    }
 
-            //Before we release the BG thread, ensure we enqueue the system prompt
-            //If we do it later, other queued calls will frontrun it. This enables startup chaining correctly
-            if (ParamsAtLoad.bAutoInsertSystemPromptOnLoad)
-            {
-                Internal->InsertTemplatedPrompt(FLlamaString::ToStd(ParamsAtLoad.SystemPrompt), EChatTemplateRole::System, false, false);
-            }
+    if (Dropped.IsValid())
+    {
+        FailBackgroundLoad(Dropped);
+    }
+}
 
-            //Callback on game thread for data sync
-            EnqueueGTTask([this, TemplateString, TemplateSource, ModelLoadedCallback]
-            {
-                FJinjaChatTemplate ChatTemplate;
-                ChatTemplate.TemplateSource = TemplateSource;
-                ChatTemplate.Jinja = TemplateString;
+void FLlamaNative::PrefetchModelFile()
+{
+    FLlamaPaths::PrefetchFileAsync(FLlamaPaths::ParsePathIntoFullPath(ModelParams.PathToModel));
+}
+
+void FLlamaNative::SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback)
+{
+    //Nothing to swap from, regular load
+    if (!IsModelLoaded())
+    {
+        ModelParams = NewParams;
+        LoadModel(true, ModelLoadedCallback);
+        return;
+    }
+
+    //ModelParams keep describing the serving model until the swap succeeds
+
+    const FLLMModelParams ParamsAtLoad = NewParams;
+
+    if (!bMigrateChatHistory)
+    {
+        LoadModelInBackground(ParamsAtLoad, ModelLoadedCallback);
+        return;
+    }
+
+    //History has to be read on the BG thread, snapshot it there then start the background load
+    EnqueueBGTask([this, ParamsAtLoad, ModelLoadedCallback](int64 TaskId)
+    {
+        TSharedPtr<FStructuredChatHistory> HistorySnapshot = MakeShared<FStructuredChatHistory>();
+        GetStructuredChatHistory(*HistorySnapshot);
+
+        LoadModelInBackground(ParamsAtLoad, ModelLoadedCallback, HistorySnapshot);
+    });
+}
+
+bool FLlamaNative::ReplayChatHistory(FLlamaInternal* Target, const FStructuredChatHistory& History, int32 StartIndex)
+{
+    for (int32 i = StartIndex; i < History.History.Num(); i++)
+    {
+        if (Target->IsRequestCancelled())
+        {
+            return false;
+        }
+
+        const FStructuredChatMessage& Message = History.History[i];
+        const std::string Content = FLlamaString::ToStd(Message.Content);
+        const size_t ExpectedMessageCount = Target->Messages.size() + (Content.empty() ? 0 : 1);
 
-                ModelState.ChatTemplateInUse = ChatTemplate;
-                ModelState.bModelIsLoaded = true;
+        Target->InsertTemplatedPrompt(Content, Message.Role, false, false);
+
+        //Prompts that weren't inserted (cancel, context overflow, failed decode) roll their message back out
+        if (Target->Messages.size() != ExpectedMessageCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FLlamaNative::LoadModelInBackground(const FLLMModelParams& ParamsAtLoad, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback, TSharedPtr<FStructuredChatHistory> MigratedHistory)
+{
+    TSharedPtr<FBackgroundLoad> Load = MakeShared<FBackgroundLoad>();
+    Load->Params = ParamsAtLoad;
+    Load->Callback = ModelLoadedCallback;
+    Load->MigratedHistory = MigratedHistory;
+
+    TSharedPtr<FBackgroundLoad> Superseded;
+    {
+        FScopeLock Lock(&PendingLoadMutex);
+        if (bBackgroundLoadsBlocked)
+        {
+            return;
+        }
 
-                bModelLoadInitiated = false;
+        if (PendingInternal)
+        {
+            //Only one background load at a time, newest request wins. Starts when the cancelled one finishes.
+            PendingInternal->CancelAllRequests();
+            Superseded = QueuedLoad;
+            QueuedLoad = Load;
+        }
+        else
+        {
+            StartBackgroundLoad(Load);
+        }
+    }
+
+    if (Superseded.IsValid())
+    {
+        FailBackgroundLoad(Superseded);
+    }
+}
+
+void FLlamaNative::StartBackgroundLoad(TSharedPtr<FBackgroundLoad> Load)
+{
+    //Only load progress and errors are forwarded until the swap, history replay shouldn't emit prompt events
+    FLlamaInternal* Pending = new FLlamaInternal();
+    BindInternalCallbacks(Pending);
+    Pending->OnTokenGenerated = nullptr;
+    Pending->OnGenerationComplete = nullptr;
+    Pending->OnPromptProcessed = nullptr;
+    Pending->OnPromptProgress = nullptr;
+    Pending->BeginRequest();
+    PendingInternal = Pending;
+    ActiveLoaderThreads.Increment();
+
+    Async(EAsyncExecution::Thread, [this, Pending, Load]
+    {
+        bool bSuccess = Pending->LoadModelFromParams(Load->Params);
+
+        //Re-prefill the snapshot on the new model while the old one keeps serving
+        if (bSuccess && Load->MigratedHistory.IsValid())
+        {
+            bSuccess = ReplayChatHistory(Pending, *Load->MigratedHistory);
+        }
+
+        //Swap on the BG thread so it happens between requests
+        EnqueueBGTask([this, Pending, bSuccess, Load](int64 TaskId)
+        {
+            bool bSwapReady = bSuccess;
+            FLLMModelParams FinalizeParams = Load->Params;
 
-                if (OnModelStateChanged)
+            if (bSwapReady && Load->MigratedHistory.IsValid())
+            {
+                //Catch up on anything that happened on the old model since the snapshot
+                FStructuredChatHistory CurrentHistory;
+                GetStructuredChatHistory(CurrentHistory);
+
+                const FStructuredChatHistory& Snapshot = *Load->MigratedHistory;
+                const int32 SnapshotCount = Snapshot.History.Num();
+                bool bSnapshotIsPrefix = CurrentHistory.History.Num() >= SnapshotCount;
+                if (bSnapshotIsPrefix && SnapshotCount > 0)
                 {
-                    OnModelStateChanged(ModelState);
+                    const FStructuredChatMessage& SnapshotLast = Snapshot.History.Last();
+                    const FStructuredChatMessage& CurrentAtSnapshot = CurrentHistory.History[SnapshotCount - 1];
+                    bSnapshotIsPrefix = SnapshotLast.Role == CurrentAtSnapshot.Role && SnapshotLast.Content == CurrentAtSnapshot.Content;
                 }
 
-                if (ModelLoadedCallback)
+                if (bSnapshotIsPrefix)
                 {
-                    ModelLoadedCallback(ModelParams.PathToModel, 0);
+                    bSwapReady = ReplayChatHistory(Pending, CurrentHistory, SnapshotCount);
                 }
-            }, TaskId);
-        }
-        else
-        {
-            EnqueueGTTask([this, ModelLoadedCallback]
+                else
+                {
+                    //History was rolled back in the meantime, rebuild it fully
+                    Pending->ResetContextHistory(false);
+                    bSwapReady = ReplayChatHistory(Pending, CurrentHistory);
+                }
+
+                //System prompt came across with the history
+                FinalizeParams.bAutoInsertSystemPromptOnLoad = false;
+            }
+
+            //Resolve the pending slot, a load queued behind this one means it was superseded even if the cancel landed late
             {
-                bModelLoadInitiated = false;
+                FScopeLock Lock(&PendingLoadMutex);
+                PendingInternal = nullptr;
 
-                //On error will be triggered earlier in the chain, but forward our model loading error status here
-                if (ModelLoadedCallback)
+                TSharedPtr<FBackgroundLoad> Next = QueuedLoad;
+                QueuedLoad.Reset();
+                if (Next.IsValid())
                 {
-                    ModelLoadedCallback(ModelParams.PathToModel, 15);
+                    bSwapReady = false;
+                    if (!bBackgroundLoadsBlocked)
+                    {
+                        StartBackgroundLoad(Next);
+                    }
                 }
-            }, TaskId);
+            }
+
+            if (bSwapReady)
+            {
+                //From here on cancels come through the native's generation like for any other request
+                Pending->ShareCancelGeneration(RequestCancelGeneration);
+                BindInternalCallbacks(Pending);
+
+                //GT readers (IsModelLoaded, StopGeneration...) see either pointer, both stay valid until the retire round trip
+                FLlamaInternal* Previous = FPlatformAtomics::InterlockedExchangePtr(&Internal, Pending);
+                RetireInternal(Previous);
+
+                //Params only describe the new model once it serves, queued ahead of the load callback
+                const FLLMModelParams CommittedParams = Load->Params;
+                EnqueueGTTask([this, CommittedParams]
+                {
+                    ModelParams = CommittedParams;
+                });
+            }
+            else
+            {
+                RetireInternal(Pending);
+            }
+
+            FinalizeModelLoad(bSwapReady, FinalizeParams, Load->Callback, TaskId);
+
+            //GT chat history still mirrors the old model, migrated or not
+            if (bSwapReady)
+            {
+                SyncModelStateToInternal();
+            }
+        });
+
+        ActiveLoaderThreads.Decrement();
+    });
+}
+
+void FLlamaNative::FailBackgroundLoad(TSharedPtr<FBackgroundLoad> Load)
+{
+    //Never started, report it like a cancelled load
+    EnqueueGTTask([this, Load]
+    {
+        if (OnError)
+        {
+            OnError(FString::Printf(TEXT("Model load cancelled for <%s>"), *Load->Params.PathToModel), 12);
+        }
+        if (Load->Callback)
+        {
+            Load->Callback(Load->Params.PathToModel, 15);
         }
     });
 }
 
+void FLlamaNative::RetireInternal(FLlamaInternal* Retired)
+{
+    RetiredInternals.Add(Retired);
+
+    //GT may still be mid-call on the old pointer, round trip through GT before freeing it on the BG thread
+    EnqueueGTTask([this, Retired]
+    {
+        EnqueueBGTask([this, Retired](int64 TaskId)
+        {
+            RetiredInternals.Remove(Retired);
+            delete Retired;
+        });
+    });
+}
+
+void FLlamaNative::FinalizeModelLoad(bool bSuccess, const FLLMModelParams& ParamsAtLoad, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback, int64 TaskId)
+{
+    //Sync model state
+    if (bSuccess)
+    {
+        const FString TemplateString = FLlamaString::ToUE(Internal->Template);
+        const FString TemplateSource = FLlamaString::ToUE(Internal->TemplateSource);
+        const int32 EmbeddingDimensions = Internal->EmbeddingDimensions();
+
+        //Before we release the BG thread, ensure we enqueue the system prompt
+        //If we do it later, other queued calls will frontrun it. This enables startup chaining correctly
+        if (ParamsAtLoad.bAutoInsertSystemPromptOnLoad)
+        {
+            Internal->InsertTemplatedPrompt(FLlamaString::ToStd(ParamsAtLoad.SystemPrompt), EChatTemplateRole::System, false, false);
+        }
+
+        //Callback on game thread for data sync
+        const FString PathToModel = ParamsAtLoad.PathToModel;
+        EnqueueGTTask([this, TemplateString, TemplateSource, EmbeddingDimensions, ModelLoadedCallback, PathToModel]
+        {
+            FJinjaChatTemplate ChatTemplate;
+            ChatTemplate.TemplateSource = TemplateSource;
+            ChatTemplate.Jinja = TemplateString;
+
+            ModelState.ChatTemplateInUse = ChatTemplate;
+            ModelState.EmbeddingDimensions = EmbeddingDimensions;
+            ModelState.bModelIsLoaded = true;
+
+            bModelLoadInitiated = false;
+
+            if (OnModelStateChanged)
+            {
+                OnModelStateChanged(ModelState);
+            }
+
+            if (ModelLoadedCallback)
+            {
+                ModelLoadedCallback(PathToModel, 0);
+            }
+        }, TaskId);
+    }
+    else
+    {
+        const FString PathToModel = ParamsAtLoad.PathToModel;
+        EnqueueGTTask([this, ModelLoadedCallback, PathToModel]
+        {
+            bModelLoadInitiated = false;
+
+            //On error will be triggered earlier in the chain, but forward our model loading error status here
+            if (ModelLoadedCallback)
+            {
+                ModelLoadedCallback(PathToModel, 15);
+            }
+        }, TaskId);
+    }
+}
+
 void FLlamaNative::UnloadModel(TFunction<void(int32 StatusCode)> ModelUnloadedCallback)
 {
     bModelLoadInitiated = false;
 
+    //Abort whatever is in flight or queued so we don't wait for it to finish before unloading
+    StopGeneration();
+    Internal->CancelAllRequests();
+
     EnqueueBGTask([this, ModelUnloadedCallback](int64 TaskId)
     {
         if (IsModelLoaded())
@@ -679,6 +1025,82 @@ bool FLlamaNative::IsNativeTickerActive()
     return TickDelegateHandle.IsValid();
 }
 
+void FLlamaNative::SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters)
+{
+    ModelParams.LoraAdapters = Adapters;
+
+    EnqueueBGTask([this, Adapters](int64 TaskId)
+    {
+        if (IsModelLoaded())
+        {
+            Internal->SetLoraAdapters(Adapters);
+        }
+    });
+}
+
+void FLlamaNative::SetControlVectors(const TArray<FLlamaControlVector>& Vectors)
+{
+    ModelParams.ControlVectors = Vectors;
+
+    EnqueueBGTask([this, Vectors](int64 TaskId)
+    {
+        if (IsModelLoaded())
+        {
+            Internal->SetControlVectors(Vectors);
+        }
+    });
+}
+
+void FLlamaNative::BenchmarkTensorPlacement(TFunction<void(const TArray<FLlamaPlacementBenchmark>& Results)> OnComplete)
+{
+    const FLLMModelParams ParamsAtBenchmark = ModelParams;
+
+    //Own thread, loading a model copy per placement would stall every queued request on the BG thread for minutes
+    ActiveLoaderThreads.Increment();
+    Async(EAsyncExecution::Thread, [this, ParamsAtBenchmark, OnComplete]
+    {
+        TArray<FLlamaPlacementBenchmark> Results = FLlamaAutoTuner::BenchmarkTensorPlacements(ParamsAtBenchmark, [this]()
+        {
+            return (bool)bBackgroundLoadsBlocked;
+        });
+
+        EnqueueGTTask([Results, OnComplete]
+        {
+            if (OnComplete)
+            {
+                OnComplete(Results);
+            }
+        });
+
+        ActiveLoaderThreads.Decrement();
+    });
+}
+
+void FLlamaNative::BenchmarkEmbeddings(const FLlamaEmbeddingBenchmarkParams& BenchParams, TFunction<void(const FLlamaEmbeddingBenchmarkReport& Report)> OnComplete)
+{
+    const FLLMModelParams ParamsAtBenchmark = ModelParams;
+
+    //Own thread, the model load and corpus passes would otherwise stall every queued request on the BG thread
+    ActiveLoaderThreads.Increment();
+    Async(EAsyncExecution::Thread, [this, ParamsAtBenchmark, BenchParams, OnComplete]
+    {
+        FLlamaEmbeddingBenchmarkReport Report = FLlamaEmbeddingBenchmark::Run(ParamsAtBenchmark, BenchParams, [this]()
+        {
+            return (bool)bBackgroundLoadsBlocked;
+        });
+
+        EnqueueGTTask([Report, OnComplete]
+        {
+            if (OnComplete)
+            {
+                OnComplete(Report);
+            }
+        });
+
+        ActiveLoaderThreads.Decrement();
+    });
+}
+
 void FLlamaNative::ResetContextHistory(bool bKeepSystemPrompt)
 {
     EnqueueBGTask([this, bKeepSystemPrompt](int64 TaskId)
@@ -779,8 +1201,8 @@ void FLlamaNative::GetStructuredChatHistory(FStructuredChatHistory& OutChatHisto
             StructuredMsg.Role = EChatTemplateRole::Assistant;
         }
 
-        // Convert content
-        StructuredMsg.Content = FString(ANSI_TO_TCHAR(Msg.content));
+        // Convert content, messages are stored as utf8
+        StructuredMsg.Content = FString(UTF8_TO_TCHAR(Msg.content));
 
         // Add to history
         OutChatHistory.History.Add(StructuredMsg);
@@ -824,4 +1246,128 @@ void FLlamaNative::GetPromptEmbeddings(const FString& Text, TFunction<void(const
             }
         });
     });
-}
\ No newline at end of file
+}
+
+void FLlamaNative::GetPromptEmbeddingsBatch(const TArray<FString>& Texts, TFunction<void(const TArray<float>& Embeddings, int32 Dimensions, const TArray<FString>& SourceTexts)> OnEmbeddings, bool bCallbackOnGameThread, TFunction<bool()> ShouldCancel)
+{
+    const TArray<FString> SourceTexts = Texts;    //copy to safely traverse threads
+
+    EnqueueBGTask([this, SourceTexts, OnEmbeddings, bCallbackOnGameThread, ShouldCancel](int64 TaskId)
+    {
+        std::vector<std::string> TextsStd;
+        TextsStd.reserve(SourceTexts.Num());
+        for (const FString& Text : SourceTexts)
+        {
+            TextsStd.push_back(FLlamaString::ToStd(Text));
+        }
+
+        std::vector<float> EmbeddingVector;
+        int32 Dimensions = 0;
+        Internal->SetRequestCancelCheck(ShouldCancel);
+        Internal->GetPromptEmbeddingsBatch(TextsStd, EmbeddingVector, Dimensions);
+
+        TArray<float> Embeddings;
+        Embeddings.Append(EmbeddingVector.data(), EmbeddingVector.size());
+
+        if (!bCallbackOnGameThread)
+        {
+            if (OnEmbeddings)
+            {
+                OnEmbeddings(Embeddings, Dimensions, SourceTexts);
+            }
+            return;
+        }
+
+        EnqueueGTTask([OnEmbeddings, Embeddings = MoveTemp(Embeddings), Dimensions, SourceTexts]
+        {
+            if (OnEmbeddings)
+            {
+                OnEmbeddings(Embeddings, Dimensions, SourceTexts);
+            }
+        });
+    });
+}
+
+void FLlamaNative::GetDocumentEmbeddings(const FString& Text, ELlamaEmbeddingAggregation Aggregation, TFunction<void(const TArray<FLlamaEmbeddingChunk>& Chunks, const TArray<float>& DocumentEmbedding, const FString& SourceText)> OnEmbeddings)
+{
+    const FString SourceText = Text;    //copy to safely traverse threads
+
+    EnqueueBGTask([this, SourceText, Aggregation, OnEmbeddings](int64 TaskId)
+    {
+        std::vector<float> ChunkEmbeddings;
+        std::vector<int32> TokenStarts;
+        std::vector<int32> TokenCounts;
+        std::vector<std::string> ChunkTexts;
+        std::vector<float> DocumentVector;
+        int32 Dimensions = 0;
+
+        Internal->GetDocumentEmbeddings(FLlamaString::ToStd(SourceText), Aggregation,
+            ChunkEmbeddings, TokenStarts, TokenCounts, ChunkTexts, DocumentVector, Dimensions);
+
+        TArray<FLlamaEmbeddingChunk> Chunks;
+        Chunks.SetNum(ChunkTexts.size());
+        for (int32 i = 0; i < Chunks.Num(); i++)
+        {
+            Chunks[i].TokenStart = TokenStarts[i];
+            Chunks[i].TokenCount = TokenCounts[i];
+            Chunks[i].Text = FLlamaString::ToUE(ChunkTexts[i]);
+            Chunks[i].Embedding.Append(ChunkEmbeddings.data() + (size_t)i * Dimensions, Dimensions);
+        }
+
+        TArray<float> DocumentEmbedding;
+        DocumentEmbedding.Append(DocumentVector.data(), DocumentVector.size());
+
+        EnqueueGTTask([OnEmbeddings, Chunks = MoveTemp(Chunks), DocumentEmbedding = MoveTemp(DocumentEmbedding), SourceText]
+        {
+            if (OnEmbeddings)
+            {
+                OnEmbeddings(Chunks, DocumentEmbedding, SourceText);
+            }
+        });
+    });
+}
+
+void FLlamaNative::RerankDocuments(const FString& Query, const TArray<FString>& Candidates, int32 TopN, TFunction<void(const TArray<FLlamaRerankResult>& Results, const FString& Query)> OnRerank)
+{
+    const FString SourceQuery = Query;    //copy to safely traverse threads
+    const TArray<FString> SourceCandidates = Candidates;
+
+    EnqueueBGTask([this, SourceQuery, SourceCandidates, TopN, OnRerank](int64 TaskId)
+    {
+        std::vector<std::string> CandidatesStd;
+        CandidatesStd.reserve(SourceCandidates.Num());
+        for (const FString& Candidate : SourceCandidates)
+        {
+            CandidatesStd.push_back(FLlamaString::ToStd(Candidate));
+        }
+
+        std::vector<float> Scores;
+        Internal->RerankDocuments(FLlamaString::ToStd(SourceQuery), CandidatesStd, Scores);
+
+        TArray<FLlamaRerankResult> Results;
+        Results.SetNum(Scores.size());
+        for (int32 i = 0; i < Results.Num(); i++)
+        {
+            Results[i].Index = i;
+            Results[i].Text = SourceCandidates[i];
+            Results[i].Score = Scores[i];
+        }
+
+        Results.StableSort([](const FLlamaRerankResult& A, const FLlamaRerankResult& B)
+        {
+            return A.Score > B.Score;
+        });
+        if (TopN > 0 && Results.Num() > TopN)
+        {
+            Results.SetNum(TopN);
+        }
+
+        EnqueueGTTask([OnRerank, Results = MoveTemp(Results), SourceQuery]
+        {
+            if (OnRerank)
+            {
+                OnRerank(Results, SourceQuery);
+            }
+        });
+    });
+}
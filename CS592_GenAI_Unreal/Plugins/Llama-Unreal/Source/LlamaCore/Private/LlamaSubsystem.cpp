@@ -4,6 +4,10 @@
 #include "HAL/PlatformTime.h"
 #include "Tickable.h"
 #include "LlamaNative.h"
+#include "LlamaModelPool.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
 #include "LlamaUtility.h"
 #include "Embedding/VectorDatabase.h"
 
@@ -31,6 +35,10 @@ void ULlamaSubsystem::Initialize(FSubsystemCollectionBase& Collection)
     {
         OnPromptProcessed.Broadcast(TokensProcessed, Role, Speed);
     };
+    LlamaNative->OnPromptProgress = [this](int32 TokensProcessed, int32 TokensTotal)
+    {
+        OnPromptProgress.Broadcast(TokensProcessed, TokensTotal);
+    };
     LlamaNative->OnResponseGenerated = [this](const FString& Response)
     {
         OnResponseGenerated.Broadcast(Response);
@@ -40,15 +48,63 @@ void ULlamaSubsystem::Initialize(FSubsystemCollectionBase& Collection)
     {
         OnError.Broadcast(ErrorMessage, ErrorCode);
     };
+    LlamaNative->OnModelLoadProgress = [this](float Progress)
+    {
+        OnModelLoadProgress.Broadcast(Progress);
+    };
 
     //All sentence ending formatting.
     ModelParams.Advanced.PartialsSeparators.Add(TEXT("."));
     ModelParams.Advanced.PartialsSeparators.Add(TEXT("?"));
     ModelParams.Advanced.PartialsSeparators.Add(TEXT("!"));
+
+    //Model pool
+    ModelPool = new FLlamaModelPool();
+
+    ModelPool->OnTokenGenerated = [this](FName ModelName, const FString& Token)
+    {
+        OnPooledTokenGenerated.Broadcast(ModelName, Token);
+    };
+    ModelPool->OnPartialGenerated = [this](FName ModelName, const FString& Partial)
+    {
+        OnPooledPartialGenerated.Broadcast(ModelName, Partial);
+    };
+    ModelPool->OnResponseGenerated = [this](FName ModelName, const FString& Response)
+    {
+        OnPooledResponseGenerated.Broadcast(ModelName, Response);
+    };
+    ModelPool->OnEmbeddings = [this](FName ModelName, const TArray<float>& Embeddings, const FString& SourceText)
+    {
+        OnPooledEmbeddings.Broadcast(ModelName, Embeddings, SourceText);
+    };
+    ModelPool->OnModelLoaded = [this](FName ModelName)
+    {
+        OnPooledModelLoaded.Broadcast(ModelName);
+    };
+    ModelPool->OnModelEvicted = [this](FName ModelName)
+    {
+        OnPooledModelEvicted.Broadcast(ModelName);
+    };
+    ModelPool->OnError = [this](FName ModelName, const FString& ErrorMessage, int32 ErrorCode)
+    {
+        OnPooledError.Broadcast(ModelName, ErrorMessage, ErrorCode);
+    };
+
+    PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &ULlamaSubsystem::HandlePreLoadMap);
+    LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &ULlamaSubsystem::HandleLevelAddedToWorld);
 }
 
 void ULlamaSubsystem::Deinitialize()
 {
+    FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+    FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+
+    if (ModelPool)
+    {
+        delete ModelPool;
+        ModelPool = nullptr;
+    }
+
 	if (LlamaNative)
 	{
 		delete LlamaNative;
@@ -128,11 +184,49 @@ void ULlamaSubsystem::UnloadModel()
     });
 }
 
+void ULlamaSubsystem::CancelModelLoad()
+{
+    LlamaNative->CancelModelLoad();
+}
+
+void ULlamaSubsystem::SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory)
+{
+    //If ticker isn't active right now, start it. This will stay active until subsystem gets destroyed.
+    if (!LlamaNative->IsNativeTickerActive())
+    {
+        LlamaNative->AddTicker();
+    }
+
+    //Keep describing the serving model until the swap succeeds
+    LlamaNative->SwapModel(NewParams, bMigrateChatHistory, [this, NewParams](const FString& ModelPath, int32 StatusCode)
+    {
+        if (StatusCode != 0)
+        {
+            return;
+        }
+
+        ModelParams = NewParams;
+        OnModelLoaded.Broadcast(ModelPath);
+    });
+}
+
 bool ULlamaSubsystem::IsModelLoaded()
 {
     return ModelState.bModelIsLoaded;
 }
 
+void ULlamaSubsystem::SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters)
+{
+    ModelParams.LoraAdapters = Adapters;
+    LlamaNative->SetLoraAdapters(Adapters);
+}
+
+void ULlamaSubsystem::SetControlVectors(const TArray<FLlamaControlVector>& Vectors)
+{
+    ModelParams.ControlVectors = Vectors;
+    LlamaNative->SetControlVectors(Vectors);
+}
+
 void ULlamaSubsystem::ResetContextHistory(bool bKeepSystemPrompt)
 {
     LlamaNative->ResetContextHistory(bKeepSystemPrompt);
@@ -158,6 +252,110 @@ void ULlamaSubsystem::ResumeGeneration()
     LlamaNative->ResumeGeneration();
 }
 
+TArray<FLlamaModelInfo> ULlamaSubsystem::GetModelCatalog(bool bForceRescan)
+{
+    return FLlamaModelCatalog::ScanModels(bForceRescan);
+}
+
+FLlamaModelPool* ULlamaSubsystem::GetModelPool()
+{
+    ModelPool->MemoryBudgetBytes = (int64)PooledMemoryBudgetMB * 1024 * 1024;
+    return ModelPool;
+}
+
+void ULlamaSubsystem::RegisterPooledModel(FName ModelName, const FLLMModelParams& Params)
+{
+    GetModelPool()->RegisterModel(ModelName, Params);
+}
+
+void ULlamaSubsystem::UnregisterPooledModel(FName ModelName)
+{
+    GetModelPool()->UnregisterModel(ModelName);
+}
+
+void ULlamaSubsystem::PrewarmPooledModel(FName ModelName)
+{
+    GetModelPool()->PrewarmModel(ModelName);
+}
+
+void ULlamaSubsystem::UnloadPooledModel(FName ModelName)
+{
+    GetModelPool()->UnloadModel(ModelName);
+}
+
+void ULlamaSubsystem::AddPooledModelMapHint(FName MapName, FName ModelName)
+{
+    GetModelPool()->AddMapPrewarmHint(MapName, ModelName);
+}
+
+void ULlamaSubsystem::InsertTemplatedPromptToPooledModel(FName ModelName, const FLlamaChatPrompt& ChatPrompt)
+{
+    GetModelPool()->InsertTemplatedPrompt(ModelName, ChatPrompt);
+}
+
+void ULlamaSubsystem::GetPooledPromptEmbeddings(FName ModelName, const FString& Text)
+{
+    GetModelPool()->GetPromptEmbeddings(ModelName, Text);
+}
+
+void ULlamaSubsystem::StopPooledGeneration(FName ModelName)
+{
+    GetModelPool()->StopGeneration(ModelName);
+}
+
+bool ULlamaSubsystem::IsPooledModelResident(FName ModelName)
+{
+    return GetModelPool()->IsModelResident(ModelName);
+}
+
+TArray<FName> ULlamaSubsystem::GetResidentPooledModels()
+{
+    return GetModelPool()->GetResidentModels();
+}
+
+void ULlamaSubsystem::HandlePreLoadMap(const FString& MapName)
+{
+    GetModelPool()->NotifyMapLoading(MapName);
+}
+
+void ULlamaSubsystem::HandleLevelAddedToWorld(ULevel* InLevel, UWorld* InWorld)
+{
+    if (InLevel)
+    {
+        GetModelPool()->NotifyMapLoading(InLevel->GetOutermost()->GetName());
+    }
+}
+
+void ULlamaSubsystem::BenchmarkTensorPlacement()
+{
+    LlamaNative->SetModelParams(ModelParams);
+
+    if (!LlamaNative->IsNativeTickerActive())
+    {
+        LlamaNative->AddTicker();
+    }
+
+    LlamaNative->BenchmarkTensorPlacement([this](const TArray<FLlamaPlacementBenchmark>& Results)
+    {
+        OnPlacementBenchmarkComplete.Broadcast(Results);
+    });
+}
+
+void ULlamaSubsystem::BenchmarkEmbeddings(const FLlamaEmbeddingBenchmarkParams& BenchParams)
+{
+    LlamaNative->SetModelParams(ModelParams);
+
+    if (!LlamaNative->IsNativeTickerActive())
+    {
+        LlamaNative->AddTicker();
+    }
+
+    LlamaNative->BenchmarkEmbeddings(BenchParams, [this](const FLlamaEmbeddingBenchmarkReport& Report)
+    {
+        OnEmbeddingBenchmarkComplete.Broadcast(Report);
+    });
+}
+
 void ULlamaSubsystem::TestVectorSearch()
 {
     FVectorDatabase* VectorDb = new FVectorDatabase();;
@@ -2,6 +2,9 @@
 
 #include "LlamaUtility.h"
 #include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/Async.h"
 
 DEFINE_LOG_CATEGORY(LlamaLog);
 
@@ -118,6 +121,55 @@ TArray<FString> FLlamaPaths::DebugListDirectoryContent(const FString& InPath)
     return Entries;
 }
 
+void FLlamaPaths::PrefetchFileAsync(const FString& InFullPath)
+{
+    static FCriticalSection InFlightMutex;
+    static TSet<FString> InFlight;
+
+    {
+        FScopeLock Lock(&InFlightMutex);
+        if (InFlight.Contains(InFullPath))
+        {
+            return;
+        }
+        InFlight.Add(InFullPath);
+    }
+
+    const FString FullPath = InFullPath;
+    //Multi-GB blocking read, own thread so it doesn't starve the shared worker pool
+    Async(EAsyncExecution::Thread, [FullPath]
+    {
+        const double StartTime = FPlatformTime::Seconds();
+
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        TUniquePtr<IFileHandle> Handle(PlatformFile.OpenRead(*FullPath));
+        int64 TotalRead = 0;
+
+        if (Handle)
+        {
+            //Sequential reads are the fastest way to get pages resident, contents are discarded
+            const int64 ChunkSize = 8 * 1024 * 1024;
+            TArray<uint8> Buffer;
+            Buffer.SetNumUninitialized(ChunkSize);
+
+            const int64 FileSize = Handle->Size();
+            while (TotalRead < FileSize)
+            {
+                const int64 ToRead = FMath::Min(ChunkSize, FileSize - TotalRead);
+                if (!Handle->Read(Buffer.GetData(), ToRead))
+                {
+                    break;
+                }
+                TotalRead += ToRead;
+            }
+        }
+
+        UE_LOG(LlamaLog, Log, TEXT("Prefetched %lld MB of <%s> in %1.2fs"), TotalRead / (1024 * 1024), *FullPath, FPlatformTime::Seconds() - StartTime);
+
+        FScopeLock Lock(&InFlightMutex);
+        InFlight.Remove(FullPath);
+    });
+}
 
 //FLlamaString
 FString FLlamaString::ToUE(const std::string& String)
@@ -0,0 +1,134 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+#include "LlamaCorpusIngestion.generated.h"
+
+class UDataTable;
+
+USTRUCT(BlueprintType)
+struct FLlamaCorpusIngestionParams
+{
+    GENERATED_USTRUCT_BODY();
+
+    //.txt/.md (split on blank lines) or .json (string array, array of objects or object of strings). Relative paths are from the project dir.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    TArray<FString> FilePaths;
+
+    //Each row becomes one text, string/text/name columns joined. Rows are read on the game thread at Start.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    TArray<TObjectPtr<UDataTable>> DataTables;
+
+    //Field read from JSON objects
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    FString JsonTextField = TEXT("text");
+
+    //Paragraphs are merged up to this size, longer ones are split with overlap. Keep below the embedding batch in tokens.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    int32 ChunkCharacters = 1000;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    int32 ChunkOverlapCharacters = 200;
+
+    //Texts per embedding call
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    int32 BatchSize = 32;
+
+    //Backpressure, reading stalls when this many batches are waiting on embedding or insertion
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    int32 MaxBatchesInFlight = 4;
+
+    //If set, committed chunks are recorded in Saved/CorpusIngestion/<Name>.json and skipped on the next run of unchanged sources.
+    //Requires IndexPath, the checkpoint only ever describes what is in the saved index.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    FString CheckpointName;
+
+    //Database file (FVectorDatabase::SaveIndex path) for checkpointed runs. Saved right before every checkpoint write and
+    //loaded at Start when the database is empty, so a resumed run continues the same index.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    FString IndexPath;
+
+    //Inserted batches between index + checkpoint saves, the final state is always saved. Each save rewrites the whole index.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Params")
+    int32 CheckpointIntervalBatches = 16;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaCorpusIngestionProgress
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Total is only final once reading has finished
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    int32 ChunksTotal = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    int32 ChunksInserted = 0;
+
+    //Already committed by a previous run
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    int32 ChunksSkipped = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    int32 ChunksFailed = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    bool bReadingComplete = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    bool bCancelled = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    float Seconds = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Corpus Ingestion Progress")
+    FString ErrorMessage;
+};
+
+//Source key (path or table name + content crc) -> leading chunks committed
+USTRUCT()
+struct FLlamaCorpusCheckpoint
+{
+    GENERATED_USTRUCT_BODY();
+
+    UPROPERTY()
+    TMap<FString, int32> CommittedChunks;
+};
+
+/**
+* Background pipeline that fills an FVectorDatabase from text, JSON and DataTable sources. Three stages overlap:
+* a reader thread loads and chunks sources into batches, the LlamaNative BG thread tokenizes and embeds them
+* (batched, embedding cache aware) and an insert thread adds results to the index and updates the checkpoint.
+* Nothing runs on the game thread after Start except the completion callback. The native and the database must
+* outlive the pipeline (until OnComplete fires or the pipeline is destroyed) and the database shouldn't be
+* modified elsewhere while it runs.
+*/
+class LLAMACORE_API FLlamaCorpusIngestion
+{
+public:
+    //Call on game thread. Native must have an embedding capable model loaded (or queued to load).
+    bool Start(class FLlamaNative* Native, class FVectorDatabase* Database, const FLlamaCorpusIngestionParams& Params,
+        TFunction<void(const FLlamaCorpusIngestionProgress& Result)> OnComplete = nullptr);
+
+    //Stops reading and inserting and cancels this pipeline's embedding batches on the native, queued or running.
+    //Other requests on the native are unaffected. OnComplete fires with bCancelled.
+    void Cancel();
+
+    bool IsRunning() const;
+
+    //Safe to poll from any thread
+    FLlamaCorpusIngestionProgress GetProgress() const;
+
+    FLlamaCorpusIngestion();
+    ~FLlamaCorpusIngestion();
+
+private:
+    //Shared with stage threads and embedding callbacks so they can outlive a cancelled pipeline
+    TSharedPtr<struct FCorpusIngestionState, ESPMode::ThreadSafe> State;
+
+    TFuture<void> ReaderFuture;
+    TFuture<void> InserterFuture;
+};
@@ -0,0 +1,134 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include <vector>
+#include "CoreMinimal.h"
+#include "LlamaDataTypes.h"
+
+#include "LlamaEmbeddingBenchmark.generated.h"
+
+USTRUCT(BlueprintType)
+struct FLlamaEmbeddingBenchmarkParams
+{
+    GENERATED_USTRUCT_BODY();
+
+    //One text per line. Empty uses a fixed synthetic corpus so results compare across versions and machines.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark Params")
+    FString CorpusFilePath;
+
+    //Texts used from the corpus (synthetic corpus size)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark Params")
+    int32 CorpusSize = 256;
+
+    //Empty = 1, half and all physical cores
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark Params")
+    TArray<int32> ThreadCounts;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark Params")
+    int32 QueryCount = 64;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark Params")
+    int32 RecallK = 10;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaEmbeddingThroughput
+{
+    GENERATED_USTRUCT_BODY();
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    int32 Threads = 0;
+
+    //GetPromptEmbeddingsBatch vs one GetPromptEmbeddings call per text
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    bool bBatched = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float Seconds = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float TextsPerSecond = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float TokensPerSecond = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaEmbeddingBenchmarkReport
+{
+    GENERATED_USTRUCT_BODY();
+
+    //False if the model didn't load or isn't a pooled embedding model
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    bool bValid = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    FString PluginVersion;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    FString ModelPath;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    FString Timestamp;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    int32 Dimensions = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    int32 CorpusTexts = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    int32 CorpusTokens = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    TArray<FLlamaEmbeddingThroughput> Throughput;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float IndexBuildSeconds = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    int32 RecallK = 0;
+
+    //Vector index top-k against exact brute force top-k, averaged over queries
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float RecallAtK = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float IndexQueryMicrosecondsMean = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float IndexQueryMicrosecondsP95 = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    float BruteForceQueryMicrosecondsMean = 0.f;
+
+    //Where the JSON report was written
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Embedding Benchmark")
+    FString ReportPath;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEmbeddingBenchmarkSignature, const FLlamaEmbeddingBenchmarkReport&, Report);
+
+/**
+* Embedding throughput (single vs batched, per thread count) and vector index quality (recall@k and query latency
+* against exact brute force) on a fixed corpus. Loads its own copy of the model in embedding mode with the
+* embedding cache off. Reports are written as JSON to Saved/Benchmarks for tracking across plugin versions. Blocks for
+* the whole run, call it off the game thread.
+*/
+class FLlamaEmbeddingBenchmark
+{
+public:
+    //ShouldAbort is polled between phases and reaches the weight load and batched decodes, an aborted run returns
+    //an invalid report without writing it
+    static FLlamaEmbeddingBenchmarkReport Run(const FLLMModelParams& ModelParams, const FLlamaEmbeddingBenchmarkParams& BenchParams,
+        TFunction<bool()> ShouldAbort = nullptr);
+
+    //Returns the written path, empty on failure
+    static FString WriteReport(const FLlamaEmbeddingBenchmarkReport& Report);
+
+private:
+    static void BuildCorpus(const FLlamaEmbeddingBenchmarkParams& BenchParams, TArray<FString>& OutTexts);
+    static void MeasureRetrieval(const std::vector<float>& CorpusEmbeddings, const std::vector<float>& QueryEmbeddings,
+        int32 Dimensions, int32 K, FLlamaEmbeddingBenchmarkReport& OutReport);
+};
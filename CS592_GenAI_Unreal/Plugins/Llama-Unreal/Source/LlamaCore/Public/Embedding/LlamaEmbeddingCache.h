@@ -0,0 +1,63 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+* Content addressed embedding store. Entries are keyed by text hash within a namespace that captures everything
+* affecting the output (model fingerprint, pooling, normalization, dimensions). A bounded in-memory LRU sits in front
+* of an append-only file under Saved/EmbeddingCache which is memory mapped for reads. Instances are shared per
+* namespace and are thread safe.
+*/
+class LLAMACORE_API FLlamaEmbeddingCache
+{
+public:
+    static TSharedPtr<FLlamaEmbeddingCache> Get(const FString& Namespace, int32 Dimensions, int32 MaxMemoryEntries, bool bPersistent);
+
+    static uint64 HashText(const char* Text, int64 Length);
+
+    //Copies Dimensions floats into OutEmbedding on hit
+    bool Find(uint64 TextHash, float* OutEmbedding);
+    void Add(uint64 TextHash, const float* Embedding);
+
+    //Appends pending entries to disk, also happens automatically every few hundred adds and on destruction
+    void Flush();
+
+    int32 GetDimensions() const { return Dimensions; }
+
+    ~FLlamaEmbeddingCache();
+
+private:
+    FLlamaEmbeddingCache(const FString& InNamespace, int32 InDimensions, int32 MaxMemoryEntries, bool bInPersistent);
+
+    void OpenStore();
+    void MapStore();
+    void UnmapStore();
+    int64 RecordSize() const;
+
+    FString StorePath;
+    int32 Dimensions = 0;
+    bool bPersistent = false;
+
+    FCriticalSection Mutex;
+
+    TLruCache<uint64, TArray<float>> MemoryCache;
+
+    //Disk store, hash -> byte offset of the record's floats within the mapped file
+    TMap<uint64, int64> DiskIndex;
+    IMappedFileHandle* MappedHandle = nullptr;
+    IMappedFileRegion* MappedRegion = nullptr;
+
+    //Added since the last flush, hash -> index into PendingData
+    TMap<uint64, int32> PendingIndex;
+    TArray<uint64> PendingKeys;
+    TArray<float> PendingData;
+
+    static FCriticalSection RegistryMutex;
+    static TMap<FString, TWeakPtr<FLlamaEmbeddingCache>> Registry;
+};
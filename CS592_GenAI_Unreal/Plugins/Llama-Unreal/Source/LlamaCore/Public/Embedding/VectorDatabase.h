@@ -2,14 +2,28 @@
 
 #pragma once
 
+#include "CoreMinimal.h"
+
 #include "VectorDatabase.generated.h"
 
+UENUM(BlueprintType)
+enum class EVectorDBMetric : uint8
+{
+    //Squared euclidean distance
+    L2,
+    //1 - dot product. Only meaningful for vectors that are already normalized, which llama embeddings are by default.
+    InnerProduct,
+    //Inner product on vectors normalized at insert and query
+    Cosine
+};
+
 USTRUCT(BlueprintType)
 struct FVectorDBParams
 {
     GENERATED_USTRUCT_BODY();
 
-    // Dimension of the elements, typically 1024
+    // Dimension of the elements, typically 1024. Should match the embedding model's output, see FLLMModelState::EmbeddingDimensions
+    // (EmbeddingOutputDimensions truncation shrinks the index and distance cost proportionally)
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VectorDB Params")
     int32 Dimensions = 16;               
 
@@ -24,45 +38,68 @@ struct FVectorDBParams
     // Controls index search speed/build speed tradeoff, strongly affects the memory consumption
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VectorDB Params")
     int32 EFConstruction = 200;
+
+    // Distance used for the index. InnerProduct is the cheapest for normalized embeddings and ranks them the same as L2/Cosine.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "VectorDB Params")
+    EVectorDBMetric Metric = EVectorDBMetric::L2;
 };
 
 
 
 /** 
-* Unreal style native wrapper for HNSW nearest neighbor search for high dimensional vectors
-* !! v0.9.8 note NB: this class is a work in progress, currently not working yet !!
+* Unreal style native wrapper for HNSW nearest neighbor search for high dimensional vectors.
+* Adds and searches are safe to run concurrently, saving, loading, mapping and InitializeDB are not.
 */
-class FVectorDatabase
+class LLAMACORE_API FVectorDatabase
 {
 public:
 
-
-
     FVectorDBParams Params;
 
     //Simple test to see if the basics run
     void BasicsTest();
 
-    //Initializes from current Params
+    //Initializes from current Params, drops any existing entries
     void InitializeDB();
 
+    bool IsInitialized() const;
+
+    //Entries currently in the index
+    int32 Num() const;
+
     //Adding Vectors
-    //Add a high dimensional vector pair with a unique db id
-    void AddVectorEmbeddingIdPair(const TArray<float>& Embedding, int64 UniqueId);
+    //Add a high dimensional vector pair with a unique db id. Fails on dimension mismatch or a full index.
+    bool AddVectorEmbeddingIdPair(const TArray<float>& Embedding, int64 UniqueId);
+
+    //Bulk add of Count row-major vectors of the index's dimensions, inserted across worker threads.
+    //Returns how many were added, failures are logged once. Blocks until done.
+    int32 AddVectors(const float* Vectors, const int64* UniqueIds, int32 Count);
+    int32 AddVectors(const TArray<float>& Vectors, const TArray<int64>& UniqueIds);
 
     //Add a high dimensional vector pair with it's text source
-    //this will internally create a DB entry
-    void AddVectorEmbeddingStringPair(const TArray<float>& Embedding, const FString& Text);
+    //this will internally create a DB entry. Returns the entry id, -1 on failure
+    int64 AddVectorEmbeddingStringPair(const TArray<float>& Embedding, const FString& Text);
 
     //Lookup single top entry
     int64 FindNearestId(const TArray<float>& ForEmbedding);
     FString FindNearestString(const TArray<float>& ForEmbedding);
 
-    //Lookup group entries
+    //Lookup group entries, nearest first
     void FindNearestNIds(TArray<int64>& IdResults, const TArray<float>& ForEmbedding, int32 N = 1);
     void FindNearestNStrings(TArray<FString>& StringResults, const TArray<float>& ForEmbedding, int32 N = 1);
 
-    //todo: add version that returns n nearest
+    //Persistence. One file holds Params, the HNSW graph and the text database. Relative paths are from the project Saved dir.
+    bool SaveIndex(const FString& Path);
+
+    //Replaces the current index and Params on success, leaves them untouched on failure
+    bool LoadIndex(const FString& Path);
+
+    //Zero-copy index format. Opening only maps the file, searches read the graph, vectors and text in place and the
+    //pages are shared between processes. A mapped database is read-only until InitializeDB or LoadIndex.
+    bool SaveMappedIndex(const FString& Path);
+    bool OpenMappedIndex(const FString& Path);
+
+    bool IsMapped() const;
 
     FVectorDatabase();
     ~FVectorDatabase();
@@ -71,6 +108,7 @@ private:
     class FHNSWPrivate* Private = nullptr;
 
     //Stores the embedded text database. Use UniqueDBId (aka primary key) to lookup the text snippet
+    FCriticalSection TextDatabaseMutex;
     TMap<int64, FString> TextDatabase;
     int64 TextDatabaseMaxId = 0;
-};
\ No newline at end of file
+};
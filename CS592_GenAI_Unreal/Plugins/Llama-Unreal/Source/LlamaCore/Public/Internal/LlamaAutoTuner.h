@@ -0,0 +1,63 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LlamaDataTypes.h"
+
+struct llama_model;
+
+struct FLlamaTunedParams
+{
+    int32 Threads = 0;
+    int32 BatchThreads = 0;
+    int32 BatchLength = 0;
+    int32 UBatchLength = 0;
+
+    //Measured at tune time, tokens/sec
+    float PrefillSpeed = 0.f;
+    float DecodeSpeed = 0.f;
+
+    bool IsValid() const { return Threads > 0 && BatchLength > 0 && UBatchLength > 0; }
+};
+
+/**
+* Micro-benchmarks decode and prefill throughput on the loaded model across thread counts and batch/ubatch
+* sizes. Results persist in Saved/Config/LlamaAutoTune.json keyed by hardware + model fingerprint + GPU layers,
+* so tuning only runs once per machine/model combination. The fingerprint is FLlamaModelCatalog's sampled one
+* (file size + first/last MB) rather than a full content hash, hashing multi-GB files would cost more than tuning.
+* BG thread only.
+*/
+class FLlamaAutoTuner
+{
+public:
+    static FString MakeKey(const FLLMModelParams& Params);
+
+    static bool FindCachedResult(const FString& Key, FLlamaTunedParams& OutResult);
+
+    //Up to 5 thread counts at 512 prefill tokens then 8 batch/ubatch configs at 1024, seconds on GPU but can take minutes
+    //for large models on CPU. ShouldAbort is polled between decodes and aborts in-flight compute, so a cancel bails quickly.
+    static FLlamaTunedParams Tune(llama_model* Model, const FLLMModelParams& Params, TFunction<bool()> ShouldAbort = nullptr);
+
+    static void SaveResult(const FString& Key, const FLlamaTunedParams& Result);
+
+    static FString ConfigFilePath();
+
+    //Loads the model once per ELlamaTensorPlacement preset (alongside any already loaded copy) and measures
+    //prefill/decode with the given params. Results are logged relative to Default. ShouldAbort is polled between
+    //placements and during measurements, aborted placements are reported invalid.
+    static TArray<FLlamaPlacementBenchmark> BenchmarkTensorPlacements(const FLLMModelParams& Params, TFunction<bool()> ShouldAbort = nullptr);
+
+private:
+    struct FMeasurement
+    {
+        float PrefillSpeed = 0.f;
+        float DecodeSpeed = 0.f;
+    };
+
+    //Temporary context per run, prefill of PromptTokens then DecodeTokens single-token decodes
+    static bool Measure(llama_model* Model, int32 Threads, int32 BatchThreads, int32 BatchLength, int32 UBatchLength,
+        int32 PromptTokens, int32 DecodeTokens, FMeasurement& OutMeasurement, const TFunction<bool()>& ShouldAbort = nullptr);
+
+    static FCriticalSection FileMutex;
+};
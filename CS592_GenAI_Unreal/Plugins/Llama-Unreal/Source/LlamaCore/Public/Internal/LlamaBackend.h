@@ -0,0 +1,47 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ELlamaDeviceType : uint8
+{
+    CPU,
+    GPU,
+    IntegratedGPU,
+    Accelerator
+};
+
+struct FLlamaDeviceInfo
+{
+    FString Name;
+    FString Description;
+    ELlamaDeviceType Type = ELlamaDeviceType::CPU;
+    uint64 MemoryFree = 0;
+    uint64 MemoryTotal = 0;
+};
+
+/**
+* Process-wide llama.cpp/ggml backend state. Initialized once by the module (or lazily on first load)
+* and torn down on module shutdown so individual model instances never touch global state.
+*/
+class FLlamaBackend
+{
+public:
+    //Safe to call repeatedly, only the first call loads backends and enumerates devices
+    static void Initialize();
+    static void Shutdown();
+    static bool IsInitialized();
+
+    //Cached at init, memory figures are from enumeration time
+    static TArray<FLlamaDeviceInfo> GetDevices();
+
+    //CPU brand + primary GPU, stable across runs. Logged once on first query.
+    static FString GetHardwareSummary();
+
+private:
+    static FCriticalSection InitMutex;
+    static bool bInitialized;
+    static TArray<FLlamaDeviceInfo> Devices;
+    static FString HardwareSummary;
+};
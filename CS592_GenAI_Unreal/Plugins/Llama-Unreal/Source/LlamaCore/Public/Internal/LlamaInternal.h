@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include "LlamaDataTypes.h"
+#include "HAL/ThreadSafeCounter64.h"
 #include "llama.h"
 
 /** 
@@ -17,14 +18,18 @@ public:
     //Core State
     llama_model* LlamaModel = nullptr;
     llama_context* Context = nullptr;
+    llama_context* EmbeddingContext = nullptr;  //optional embeddings context sharing LlamaModel, see bCreateEmbeddingContext
     llama_sampler* Sampler = nullptr;
     struct common_sampler* CommonSampler = nullptr;
 
     //main streaming callback
     TFunction<void(const std::string& TokenPiece)>OnTokenGenerated = nullptr;
     TFunction<void(int32 TokensProcessed, EChatTemplateRole ForRole, float Speed)>OnPromptProcessed = nullptr;   //useful for waiting for system prompt ready
+    TFunction<void(int32 TokensDone, int32 TokensTotal)>OnPromptProgress = nullptr;   //emitted after each prompt chunk is decoded
     TFunction<void(const std::string& Response, float Time, int32 Tokens, float Speed)>OnGenerationComplete = nullptr;
 
+    TFunction<void(float Progress)> OnModelLoadProgress = nullptr;    //called on the loading thread
+
     //NB basic error codes: 1x == Load Error, 2x == Process Prompt error, 3x == Generate error. 1xx == Misc errors
     TFunction<void(const FString& ErrorMessage, int32 ErrorCode)> OnError = nullptr;     //doesn't use std::string due to expected consumer
 
@@ -44,6 +49,13 @@ public:
     void UnloadModel();
     bool IsModelLoaded();
 
+    //Replaces the context's active adapters. Adapters are loaded once per model and cached, so switching
+    //between known adapters is cheap. Existing KV entries were computed with the previous adapters.
+    bool SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters);
+
+    //Blends the given control vectors (strength scaled, per vector layer range) into one and applies it. Empty clears.
+    bool SetControlVectors(const TArray<FLlamaControlVector>& Vectors);
+
     //Generation
     void ResetContextHistory(bool bKeepSystemsPrompt = false);
     void RollbackContextHistoryByTokens(int32 NTokensToErase);
@@ -64,10 +76,28 @@ public:
     std::string WrapPromptForRole(const std::string& Text, EChatTemplateRole Role, const std::string& OverrideTemplate, bool bAddAssistantBoS = false);
 
 
-    //flips bGenerationActive which will stop generation on next token. Threadsafe call.
+    //flips bGenerationActive which will stop generation on next token and cancels the active request,
+    //aborting in-flight prompt/embedding graph compute via the llama abort callback. Threadsafe call.
     void StopGeneration();
     bool IsGenerating();
 
+    //Request cancellation. Each request begins with its id and the cancel generation snapshotted when it was queued.
+    //CancelActiveRequest only cancels the request running right now (by id). CancelAllRequests bumps the generation,
+    //cancelling the running request and every one queued before the call. BeginRequest() starts a standalone request.
+    void BeginRequest(int32 QueuedGeneration, int64 RequestId);
+    void BeginRequest();
+    int32 GetCancelGeneration();
+    void CancelActiveRequest();
+    void CancelAllRequests();
+    bool IsRequestCancelled();
+
+    //Extra cancel condition for the running request only, cleared by the next BeginRequest. Set it from the thread running the request.
+    void SetRequestCancelCheck(TFunction<bool()> CancelCheck);
+
+    //Lets an owner share one cancel generation across internals so queued snapshots stay valid after a model swap.
+    //Also begins a fresh request on it.
+    void ShareCancelGeneration(const TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe>& Generation);
+
     int32 MaxContext();
     int32 UsedContext();
 
@@ -77,14 +107,35 @@ public:
 
     //for embedding models
 
+    //Output vector size: EmbeddingOutputDimensions (Matryoshka prefix) if set, else the model's n_embd. 0 if not embedding capable.
+    int32 EmbeddingDimensions();
+
     //take a prompt and return an array of floats signifying the embeddings
     void GetPromptEmbeddings(const std::string& Text, std::vector<float>& Embeddings);
 
+    //Packs as many texts per decode as fit n_batch tokens / n_seq_max sequences, each with its own seq_id.
+    //Output is Texts.size() x OutDimensions contiguous floats in input order. Requires a pooled embedding model.
+    bool GetPromptEmbeddingsBatch(const std::vector<std::string>& Texts, std::vector<float>& OutEmbeddings, int32& OutDimensions);
+
+    //Cross-encoder scoring for reranker models (pooling RANK). Each (Query, Document) pair is one sequence, packed like
+    //GetPromptEmbeddingsBatch. OutScores is in Documents order.
+    bool RerankDocuments(const std::string& Query, const std::vector<std::string>& Documents, std::vector<float>& OutScores);
+
+    //Splits Text into overlapping token windows (EmbeddingChunkTokens/EmbeddingChunkOverlap) and embeds them batched.
+    //OutChunkEmbeddings is chunks x OutDimensions. If Aggregation isn't PerChunk, OutDocumentEmbedding gets the pooled vector.
+    bool GetDocumentEmbeddings(const std::string& Text, ELlamaEmbeddingAggregation Aggregation,
+        std::vector<float>& OutChunkEmbeddings, std::vector<int32>& OutTokenStarts, std::vector<int32>& OutTokenCounts,
+        std::vector<std::string>& OutChunkTexts, std::vector<float>& OutDocumentEmbedding, int32& OutDimensions);
+
 protected:
-    //Wrapper for user<->assistant templated conversation
+    //Wrapper for user<->assistant templated conversation. Decodes in n_batch sized chunks, returns -1 if nothing was inserted:
+    //cancelled, tokenize failure, context overflow or a failed decode (KV rolled back).
     int32 ProcessPrompt(const std::string& Prompt, EChatTemplateRole Role = EChatTemplateRole::Unknown);
     std::string Generate(const std::string& Prompt = "", bool bAppendToMessageHistory = true);
 
+    //Activates all model tensors and runs a representative decode, then clears KV. Called at load time, abortable via cancel.
+    void WarmupContext(const std::string& RepresentativePrompt);
+
     void EmitErrorMessage(const FString& ErrorMessage, int32 ErrorCode = -1, const FString& FunctionName = TEXT("unknown"));
 
     int32 ApplyTemplateToContextHistory(bool bAddAssistantBOS = false);
@@ -96,7 +147,50 @@ protected:
     int32 FilledContextCharLength = 0;
     FThreadSafeBool bGenerationActive = false;
 
-    //Embedding Decoding utilities
-    void BatchDecodeEmbedding(llama_context* ctx, llama_batch& batch, float* output, int n_seq, int n_embd, int embd_norm);
+    TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> CancelGeneration = MakeShared<FThreadSafeCounter, ESPMode::ThreadSafe>();
+    FThreadSafeCounter ActiveGeneration = 0;
+    FThreadSafeCounter64 ActiveRequestId = 0;
+    FThreadSafeCounter64 CancelledRequestId = -1;
+    TFunction<bool()> RequestCancelCheck;
+
+    //Only batch decodes (prompt/embeddings) are abortable mid-compute, single token decodes finish normally
+    FThreadSafeBool bComputeAbortable = false;
+    static bool AbortCallback(void* UserData);
+
+    //Forwards llama load progress, returning false cancels the load
+    float LastReportedLoadProgress = 0.f;
+    static bool LoadProgressCallback(float Progress, void* UserData);
+
+    //Full path -> adapter, freed together with the model
+    TMap<FString, llama_adapter_lora*> LoadedLoraAdapters;
+    llama_adapter_lora* GetOrLoadLoraAdapter(const FString& Path);
+
+    //Full path -> unscaled control vector data for layers [1, n_layer]
+    TMap<FString, std::vector<float>> LoadedControlVectors;
+    const std::vector<float>* GetOrLoadControlVector(const FString& Path);
+
+    //Tensor placement overrides, kept alive for the model's lifetime
+    std::vector<std::string> TensorOverridePatterns;
+    std::vector<llama_model_tensor_buft_override> TensorOverrides;
+    void ApplyTensorPlacement(const FLLMModelParams& InModelParams, llama_model_params& OutModelParams);
+
+    //Shared per model + embedding settings, null unless enabled. Bypassed while adapters apply to the embedding context,
+    //truncated inputs aren't stored.
+    TSharedPtr<class FLlamaEmbeddingCache> EmbeddingCache;
+
+    //Dedicated embedding context if one was created, else the main context
+    llama_context* GetEmbeddingContext();
+    bool CreateEmbeddingContext(const FLLMModelParams& InModelParams);
+
+    //Reused for all embedding decodes, sized to n_batch and freed on unload
+    llama_batch EmbeddingBatch = {};
+    int32 EmbeddingBatchCapacity = 0;
+    llama_batch& GetEmbeddingBatch();
+
+    //Embedding Decoding utilities. Pooled output is written per seq_id [0, n_seq), otherwise per token, n_embd floats each.
+    bool BatchDecodeEmbedding(llama_context* ctx, llama_batch& batch, float* output, int n_seq, int n_embd, int embd_norm);
     void BatchAddSeq(llama_batch& batch, const std::vector<int32_t>& tokens, llama_seq_id seq_id);
+
+    //Model's "rerank" chat template if present, else BOS query EOS SEP document EOS per the vocab's add flags
+    std::vector<llama_token> TokenizeRerankPair(llama_context* InContext, const std::string& Query, const std::string& Document);
 };
\ No newline at end of file
@@ -43,10 +43,26 @@ public:
     UPROPERTY(BlueprintAssignable)
     FOnPromptProcessedSignature OnPromptProcessed;
 
+    //Emitted after each decoded prompt chunk; TokensProcessed of TokensTotal for the current prompt
+    UPROPERTY(BlueprintAssignable)
+    FOnPromptProgressSignature OnPromptProgress;
+
     //Requires embedding mode, results are suitable for RAG type ops
     UPROPERTY(BlueprintAssignable)
     FOnEmbeddingsSignature OnEmbeddings;
 
+    //Batched variant, Embeddings is SourceTexts.Num() x Dimensions contiguous floats in input order
+    UPROPERTY(BlueprintAssignable)
+    FOnEmbeddingsBatchSignature OnEmbeddingsBatch;
+
+    //Long document result, per chunk vectors with token offsets and optionally a pooled document vector
+    UPROPERTY(BlueprintAssignable)
+    FOnDocumentEmbeddingsSignature OnDocumentEmbeddings;
+
+    //Reranked candidates, best first
+    UPROPERTY(BlueprintAssignable)
+    FOnRerankSignature OnRerank;
+
     //Whenever the model stops generating
     UPROPERTY(BlueprintAssignable)
     FOnEndOfStreamSignature OnEndOfStream;
@@ -57,6 +73,10 @@ public:
     UPROPERTY(BlueprintAssignable)
     FModelNameSignature OnModelLoaded;
 
+    //0-1 progress while model weights are loading
+    UPROPERTY(BlueprintAssignable)
+    FOnModelLoadProgressSignature OnModelLoadProgress;
+
     //Catch internal errors
     UPROPERTY(BlueprintAssignable)
     FOnErrorSignature OnError;
@@ -84,10 +104,26 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
     void UnloadModel();
 
+    //Aborts an in-progress model load
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
+    void CancelModelLoad();
+
+    //Swaps to a different model without going mute, the current model serves until the new one is ready. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
+    void SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory = true);
+
     UFUNCTION(BlueprintPure, Category = "LLM Model Component")
     bool IsModelLoaded();
 
 
+    //Swap persona adapters on the loaded model, much cheaper than a model load or a long system prompt. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
+    void SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters);
+
+    //Steer tone (e.g. mood) with blended control vectors, costs no prompt tokens. Empty array clears. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
+    void SetControlVectors(const TArray<FLlamaControlVector>& Vectors);
+
     //Clears the prompt, allowing a new context - optionally keeping the initial system prompt
     UFUNCTION(BlueprintCallable, Category = "LLM Model Component")
     void ResetContextHistory(bool bKeepSystemPrompt = false);
@@ -145,6 +181,18 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LLM Model Embedding Mode")
     void GeneratePromptEmbeddingsForText(const FString& Text);
 
+    //Embeds many texts per decode, much faster than one call per text. Requires embedding mode with a pooled model.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Embedding Mode")
+    void GeneratePromptEmbeddingsForTexts(const TArray<FString>& Texts);
+
+    //Embeds texts of any length (quest logs, books) as overlapping windows, see EmbeddingChunkTokens/EmbeddingChunkOverlap
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Embedding Mode")
+    void GeneratePromptEmbeddingsForDocument(const FString& Text, ELlamaEmbeddingAggregation Aggregation = ELlamaEmbeddingAggregation::Mean);
+
+    //Requires embedding mode with a reranker (cross-encoder) model. Scores all candidates in packed decodes, result via OnRerank.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Embedding Mode")
+    void RerankDocuments(const FString& Query, const TArray<FString>& Candidates, int32 TopN = 5);
+
 private:
     class FLlamaNative* LlamaNative;
 };
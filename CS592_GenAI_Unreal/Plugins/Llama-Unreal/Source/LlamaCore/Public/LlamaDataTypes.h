@@ -13,6 +13,30 @@ enum class EChatTemplateRole : uint8
     Unknown = 255
 };
 
+//How chunk vectors of a long document are combined into one document vector
+UENUM(BlueprintType)
+enum class ELlamaEmbeddingAggregation : uint8
+{
+    //Only per chunk vectors, no document vector
+    PerChunk,
+    //Token count weighted mean, renormalized
+    Mean,
+    //Element-wise max, renormalized
+    Max
+};
+
+//Where model weights live and how they're laid out, see FLLMModelParams::TensorPlacement
+UENUM(BlueprintType)
+enum class ELlamaTensorPlacement : uint8
+{
+    //llama.cpp defaults
+    Default,
+    //Repack weights into SIMD friendly CPU layouts and, for CPU-only loads (GPULayers 0), bypass the host buffer so repacked buffers are used. Best for CPU-only decode.
+    CPUOptimized,
+    //MoE expert tensors stay in system RAM, attention/shared weights offload to GPU. Fits large MoE models in small VRAM.
+    KeepExpertsOnHost
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnErrorSignature, const FString&, ErrorMessage, int32, ErrorCode);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTokenGeneratedSignature, const FString&, Token);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnResponseGeneratedSignature, const FString&, Response);
@@ -21,8 +45,84 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPartialSignature, const FString&,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPromptHistorySignature, FString, History);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEndOfStreamSignature, bool, bStopSequenceTriggered, float, TokensPerSecond);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnPromptProcessedSignature, int32, TokensProcessed, EChatTemplateRole, Role, float, TokensPerSecond);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPromptProgressSignature, int32, TokensProcessed, int32, TokensTotal);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FVoidEventSignature);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnModelLoadProgressSignature, float, Progress);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEmbeddingsSignature, const TArray<float>&, Embeddings, const FString&, SourceText);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnEmbeddingsBatchSignature, const TArray<float>&, Embeddings, int32, Dimensions, const TArray<FString>&, SourceTexts);
+
+//Model pool variants, carry the pooled model name
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPooledModelNameSignature, FName, ModelName);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPooledTextSignature, FName, ModelName, const FString&, Text);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnPooledEmbeddingsSignature, FName, ModelName, const TArray<float>&, Embeddings, const FString&, SourceText);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnPooledErrorSignature, FName, ModelName, const FString&, ErrorMessage, int32, ErrorCode);
+
+//One scored candidate from a reranker model
+USTRUCT(BlueprintType)
+struct FLlamaRerankResult
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Position in the submitted candidates
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Rerank Result")
+    int32 Index = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Rerank Result")
+    FString Text;
+
+    //Raw relevance logit from the classification head, higher is more relevant
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Rerank Result")
+    float Score = 0.f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnRerankSignature, const TArray<FLlamaRerankResult>&, Results, const FString&, Query);
+
+//One overlapping window of a long document
+USTRUCT(BlueprintType)
+struct FLlamaEmbeddingChunk
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Offsets into the document's tokens (without special tokens)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Embedding Chunk")
+    int32 TokenStart = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Embedding Chunk")
+    int32 TokenCount = 0;
+
+    //Detokenized window, useful as the retrieved snippet
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Embedding Chunk")
+    FString Text;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Embedding Chunk")
+    TArray<float> Embedding;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDocumentEmbeddingsSignature, const TArray<FLlamaEmbeddingChunk>&, Chunks, const TArray<float>&, DocumentEmbedding, const FString&, SourceText);
+
+USTRUCT(BlueprintType)
+struct FLlamaPlacementBenchmark
+{
+    GENERATED_USTRUCT_BODY();
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Placement Benchmark")
+    ELlamaTensorPlacement Placement = ELlamaTensorPlacement::Default;
+
+    //False if the model failed to load or run with this placement
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Placement Benchmark")
+    bool bValid = false;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Placement Benchmark")
+    float LoadTime = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Placement Benchmark")
+    float PrefillTokensPerSecond = 0.f;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Placement Benchmark")
+    float DecodeTokensPerSecond = 0.f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPlacementBenchmarkSignature, const TArray<FLlamaPlacementBenchmark>&, Results);
 
 USTRUCT(BlueprintType)
 struct FLlamaRunTimings
@@ -128,6 +228,52 @@ struct FLLMModelAdvancedParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     bool bEmbeddingMode = false;
 
+    //Keeps chat and retrieval on one set of weights: a second embeddings context is created on the loaded model
+    //so embedding calls work without bEmbeddingMode. Ignored in embedding mode.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bCreateEmbeddingContext = false;
+
+    //Embedding context KV size, only needs to hold one batch of embedding inputs
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingContextLength = 2048;
+
+    //Embedding context threads, -1 = Threads
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingThreads = -1;
+
+    //Embedding mode: most texts packed into one decode by batched embedding calls (also bounded by MaxBatchLength tokens)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingMaxSequences = 64;
+
+    //Embedding mode: window size for long document embedding, 0 = MaxBatchLength
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingChunkTokens = 0;
+
+    //Embedding mode: tokens shared between neighbouring windows so content at a boundary lands whole in one chunk
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingChunkOverlap = 64;
+
+    //Embedding mode: keep only the leading N dimensions then renormalize, 0 = full size. Only for Matryoshka trained
+    //models (e.g. nomic-embed v1.5, mxbai, Qwen3-Embedding), others lose quality quickly. Set FVectorDBParams::Dimensions to match.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingOutputDimensions = 0;
+
+    //Embedding mode: -1 none, 0 max absolute (int16 range), 1 taxicab, 2 euclidean, >2 p-norm
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingNormalization = 2;
+
+    //Embedding mode: previously embedded texts (same model + settings) are a hash lookup instead of a decode
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bUseEmbeddingCache = true;
+
+    //In-memory LRU size in vectors
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 EmbeddingCacheMemoryEntries = 4096;
+
+    //Keep cached vectors across sessions in Saved/EmbeddingCache
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bPersistEmbeddingCache = true;
+
     //if set above 0.f it will sleep between generation passes to ease gpu pressure
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     float TokenGenerationPacingSleep = 0.f;
@@ -136,7 +282,7 @@ struct FLLMModelAdvancedParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     float PromptProcessingPacingSleep = 0.f;
 
-    //this part is only active if PromptProcessingPacingSleep > 0.f. Splits prompts into n chunks with sleep
+    //this part is only active if PromptProcessingPacingSleep > 0.f. Splits prompts into at least n chunks (each at most MaxBatchLength) with sleep
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     int32 PromptProcessingPacingSplitN = 4;
 
@@ -224,6 +370,42 @@ struct FJinjaChatTemplate
     FString Jinja = TEXT("");
 };
 
+//LoRA adapter applied on top of the base model weights, e.g. per persona
+USTRUCT(BlueprintType)
+struct FLlamaLoraAdapter
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Same path rules as PathToModel. Must be trained against the base model.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoRA Adapter")
+    FString Path = TEXT("");
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoRA Adapter")
+    float Scale = 1.f;
+};
+
+//Control vector (.gguf from cvector-generator) that steers hidden states without using context, e.g. mood
+USTRUCT(BlueprintType)
+struct FLlamaControlVector
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Same path rules as PathToModel
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control Vector")
+    FString Path = TEXT("");
+
+    //Vectors are summed scaled by strength, negative values steer away
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control Vector")
+    float Strength = 1.f;
+
+    //Inclusive layer range this vector applies to, -1 = first/last layer
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control Vector")
+    int32 LayerStart = -1;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Control Vector")
+    int32 LayerEnd = -1;
+};
+
 //Initial state fed into the model
 USTRUCT(BlueprintType)
 struct FLLMModelParams
@@ -245,6 +427,10 @@ struct FLLMModelParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     bool bAutoLoadModelOnStartup = true;
 
+    //If a model is already loaded, keep serving it while the new one loads on a separate thread and swap when ready
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bKeepPreviousModelWhileLoading = false;
+
     //If true, all prompt inserts/rollbacks only modify modelstate and do not forward to llama component (see impersonation)
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     bool bRemoteMode = false;
@@ -267,15 +453,66 @@ struct FLLMModelParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     int32 GPULayers = 50;
 
+    //Weight layout/placement preset, applied on top of GPULayers
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    ELlamaTensorPlacement TensorPlacement = ELlamaTensorPlacement::Default;
+
+    //Allow ggml to repack weights into extra (e.g. SIMD interleaved) buffer types at load. Forced on by CPUOptimized.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    bool bUseExtraBufferTypes = true;
+
+    //Regex patterns of tensor names (e.g. "blk\.[0-9]+\.ffn_.*") forced into CPU memory, in addition to the preset
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    TArray<FString> CPUTensorOverridePatterns;
+
+    //Memory map the gguf instead of reading it. Mapped pages stay in the OS page cache across reloads.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    bool bUseMmap = true;
+
+    //Lock model weights in RAM so they can't be paged out. May require raised OS limits.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    bool bUseMlock = false;
+
+    //Read through the gguf on a background thread at load so weight pages are warm before first use
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Residency")
+    bool bPrefetchModelFile = false;
+
+    //Applied to the context after load, change at runtime with SetLoraAdapters
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Adapters")
+    TArray<FLlamaLoraAdapter> LoraAdapters;
+
+    //Blended and applied to the context after load, change at runtime with SetControlVectors
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params - Adapters")
+    TArray<FLlamaControlVector> ControlVectors;
+
+    //Threads used for single token generation
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     int32 Threads = 8;
 
+    //Threads used for prompt/batch processing, -1 = same as Threads
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 BatchThreads = -1;
+
+    //Logical batch, the most tokens submitted per decode call
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     int32 MaxBatchLength = 1024;
 
+    //Physical batch actually computed at once, clamped to MaxBatchLength
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    int32 MaxUBatchLength = 512;
+
+    //Benchmark threads/batch/ubatch on first load of this model on this machine and use the result instead of the values above.
+    //Result is cached in Saved/Config/LlamaAutoTune.json, delete the entry to re-tune.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bAutoTuneHardware = false;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     int32 Seed = -1;
 
+    //Runs a warmup decode during load (touching all weights and compute buffers) so the first real prompt isn't slower than the rest
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
+    bool bWarmupOnLoad = true;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Params")
     FLLMModelAdvancedParams Advanced;
 };
@@ -316,6 +553,10 @@ struct FLLMModelState
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model State")
     EChatTemplateRole LastRole = EChatTemplateRole::Unknown;
 
+    //Size of returned embedding vectors after any truncation, 0 if the model can't embed. Use for FVectorDBParams::Dimensions.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model State")
+    int32 EmbeddingDimensions = 0;
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model State")
     FJinjaChatTemplate ChatTemplateInUse;
 };
@@ -329,6 +570,10 @@ struct FLLMThreadTask
 
     UPROPERTY()
     int64 TaskId = 0;
+
+    //Cancel generation at enqueue, a cancel issued before the task runs still cancels it
+    UPROPERTY()
+    int32 CancelGeneration = 0;
 };
 
 
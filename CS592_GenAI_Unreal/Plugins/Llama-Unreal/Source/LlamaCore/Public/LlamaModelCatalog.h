@@ -0,0 +1,102 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "LlamaModelCatalog.generated.h"
+
+//Metadata read from a gguf header, no weights are touched
+USTRUCT(BlueprintType)
+struct FLlamaModelInfo
+{
+    GENERATED_USTRUCT_BODY();
+
+    //Absolute path to the gguf
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FString Path;
+
+    //general.name if present, otherwise the file name
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FString Name;
+
+    //e.g. llama, qwen2, gemma3, bert
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FString Architecture;
+
+    //Sum of all tensor elements
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int64 ParameterCount = 0;
+
+    //e.g. Q4_K_M, derived from general.file_type
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FString QuantizationType;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int32 ContextLengthTrained = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int32 EmbeddingDimensions = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int32 LayerCount = 0;
+
+    //-1 if unspecified, otherwise llama_pooling_type. Set for embedding and reranker models.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int32 PoolingType = -1;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (MultiLine = true), Category = "Llama Model Info")
+    FString ChatTemplate;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    int64 FileSize = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FDateTime ModifiedTime;
+
+    //Stable id for caches keyed by model, see FLlamaModelCatalog::ComputeFingerprint
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Llama Model Info")
+    FString Fingerprint;
+};
+
+//On-disk index format
+USTRUCT()
+struct FLlamaModelCatalogIndex
+{
+    GENERATED_USTRUCT_BODY();
+
+    UPROPERTY()
+    TArray<FLlamaModelInfo> Models;
+};
+
+/**
+* Scans FLlamaPaths::ModelsRelativeRootPath() for gguf files and reads their header metadata.
+* Results are cached in an index file and only re-read when a file's size or timestamp changes.
+* Thread safe.
+*/
+class LLAMACORE_API FLlamaModelCatalog
+{
+public:
+    //Returns all models in the models root, uses the cached index unless bForceRescan
+    static TArray<FLlamaModelInfo> ScanModels(bool bForceRescan = false);
+
+    //Header-only read of a single gguf
+    static bool ReadModelInfo(const FString& FullPath, FLlamaModelInfo& OutInfo);
+
+    //Find by path (relative or absolute), returns false if the file isn't a readable gguf
+    static bool FindModelInfo(const FString& RelativeOrAbsolutePath, FLlamaModelInfo& OutInfo);
+
+    //Cheap content id: hash of size + first and last MB of the file. Doesn't read the full weights.
+    static FString ComputeFingerprint(const FString& FullPath);
+
+    static FString IndexFilePath();
+
+private:
+    static FCriticalSection CatalogMutex;
+    static TMap<FString, FLlamaModelInfo> CachedInfos;
+    static bool bIndexLoaded;
+
+    static void LoadIndexIfNeeded();
+    static void SaveIndex();
+    static bool IsCachedInfoValid(const FLlamaModelInfo& Info);
+};
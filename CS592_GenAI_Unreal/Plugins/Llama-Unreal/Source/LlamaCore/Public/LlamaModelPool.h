@@ -0,0 +1,85 @@
+// Copyright 2025-current Getnamo.
+
+#pragma once
+
+#include "LlamaDataTypes.h"
+#include "CoreMinimal.h"
+
+class FLlamaNative;
+
+/**
+* Named set of FLlamaNative instances sharing a memory budget. Models are registered with params up front and
+* loaded on first use or via prewarm hints. When a load would exceed the budget, the least recently used idle
+* models are unloaded first. Game thread only.
+*/
+class LLAMACORE_API FLlamaModelPool
+{
+public:
+
+	//Callbacks, all carry the pooled model name
+	TFunction<void(FName ModelName, const FString& Token)> OnTokenGenerated;
+	TFunction<void(FName ModelName, const FString& Partial)> OnPartialGenerated;
+	TFunction<void(FName ModelName, const FString& Response)> OnResponseGenerated;
+	TFunction<void(FName ModelName, const TArray<float>& Embeddings, const FString& SourceText)> OnEmbeddings;
+	TFunction<void(FName ModelName)> OnModelLoaded;
+	TFunction<void(FName ModelName)> OnModelEvicted;
+	TFunction<void(FName ModelName, const FString& ErrorMessage, int32 ErrorCode)> OnError;
+
+	//0 = unlimited
+	int64 MemoryBudgetBytes = 0;
+
+	//Registering doesn't load, re-registering an existing name updates params for its next load
+	void RegisterModel(FName ModelName, const FLLMModelParams& Params);
+	void UnregisterModel(FName ModelName);
+	bool IsModelRegistered(FName ModelName) const;
+	bool IsModelResident(FName ModelName) const;
+
+	//Ensures the model is loaded or loading and marks it most recently used. Returns nullptr if not registered.
+	FLlamaNative* AcquireModel(FName ModelName);
+
+	//Start loading ahead of use. If the budget can't be met without evicting busy models, only the file is prefetched.
+	void PrewarmModel(FName ModelName);
+	void UnloadModel(FName ModelName);
+
+	//Convenience wrappers that acquire, then forward to the pooled native
+	void InsertTemplatedPrompt(FName ModelName, const FLlamaChatPrompt& Prompt);
+	void GetPromptEmbeddings(FName ModelName, const FString& Text);
+	void StopGeneration(FName ModelName);
+
+	//Prewarm hints, map names are matched by short package name (e.g. "MyLevel")
+	void AddMapPrewarmHint(FName MapName, FName ModelName);
+	void RemoveMapPrewarmHints(FName MapName);
+	void NotifyMapLoading(const FString& MapOrPackageName);
+
+	int64 GetResidentBytes() const;
+	TArray<FName> GetResidentModels() const;
+
+	FLlamaModelPool();
+	~FLlamaModelPool();
+
+protected:
+	struct FPooledModel
+	{
+		FLLMModelParams Params;
+		FLlamaNative* Native = nullptr;
+		int64 EstimatedBytes = 0;
+		double LastUsedTime = 0.0;
+		int32 ActiveRequests = 0;
+		bool bResident = false;		//loaded or loading, counts against budget
+		bool bLoading = false;		//load queued or running, busy so it can't be evicted mid-load
+	};
+
+	TMap<FName, FPooledModel> Models;
+	TMultiMap<FName, FName> MapPrewarmHints;
+
+	//Weights on disk + f16 KV cache at full context
+	static int64 EstimateModelBytes(const FLLMModelParams& Params);
+
+	void BindNativeCallbacks(FName ModelName, FLlamaNative* Native);
+	void LoadIfNeeded(FName ModelName, FPooledModel& Model);
+	bool IsModelBusy(const FPooledModel& Model) const;
+
+	//Unloads LRU idle models until IncomingBytes fits, returns false if it can't fit
+	bool EvictToFit(int64 IncomingBytes, FName ExcludeModel, bool bDryRun = false);
+	void EvictModel(FName ModelName, FPooledModel& Model);
+};
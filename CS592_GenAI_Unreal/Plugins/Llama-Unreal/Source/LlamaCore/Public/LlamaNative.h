@@ -19,10 +19,12 @@ public:
 	TFunction<void(const FString& Partial)> OnPartialGenerated;		//usually considered sentences, good for TTS.
 	TFunction<void(const FString& Response)> OnResponseGenerated;	//per round
 	TFunction<void(int32 TokensProcessed, EChatTemplateRole ForRole, float Speed)> OnPromptProcessed;	//when an inserted prompt has finished processing (non-generation prompt)
+	TFunction<void(int32 TokensProcessed, int32 TokensTotal)> OnPromptProgress;	//per decoded chunk of a prompt, useful for long prompt ingestion
 	TFunction<void()> OnGenerationStarted;
 	TFunction<void(const FLlamaRunTimings& Timings)> OnGenerationFinished;
 	TFunction<void(const FString& ErrorMessage, int32 ErrorCode)> OnError;
 	TFunction<void(const FLLMModelState& UpdatedModelState)> OnModelStateChanged;
+	TFunction<void(float Progress)> OnModelLoadProgress;	//0-1 while weights are loading
 
 	//Expected to be set before load model
 	void SetModelParams(const FLLMModelParams& Params);
@@ -32,6 +34,32 @@ public:
 	void UnloadModel(TFunction<void(int32 StatusCode)> ModelUnloadedCallback = nullptr);
 	bool IsModelLoaded();
 
+	//Aborts an in-progress LoadModel or background swap, the load callback will receive an error status
+	void CancelModelLoad();
+
+	//Loads NewParams in the background while the current model keeps serving, then swaps between requests.
+	//If bMigrateChatHistory, the current chat history is re-prefilled on the new model before the swap, a failed replay fails the swap.
+	//A newer swap cancels the pending one and starts once it has bailed. ModelParams only change once the swap succeeds.
+	void SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory = true, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback = nullptr);
+
+	//Hot-swaps the active LoRA adapters on the loaded model, e.g. to switch persona without a reload or a long system prompt.
+	//Adapters stay cached on the model once loaded. Updates ModelParams.LoraAdapters.
+	void SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters);
+
+	//Blends and applies control vectors to steer tone without spending context, empty clears. Updates ModelParams.ControlVectors.
+	void SetControlVectors(const TArray<FLlamaControlVector>& Vectors);
+
+	//Loads ModelParams once per tensor placement preset and measures tok/s on its own thread, the current model keeps serving.
+	//Each placement loads a full extra copy of the model next to the loaded one (one at a time), unload first if memory is tight.
+	void BenchmarkTensorPlacement(TFunction<void(const TArray<FLlamaPlacementBenchmark>& Results)> OnComplete);
+
+	//Loads ModelParams as an embedding model on its own thread and measures throughput and vector index recall, writes a JSON report.
+	//Like BenchmarkTensorPlacement this loads an extra copy of the model, the current model keeps serving.
+	void BenchmarkEmbeddings(const struct FLlamaEmbeddingBenchmarkParams& BenchParams, TFunction<void(const struct FLlamaEmbeddingBenchmarkReport& Report)> OnComplete);
+
+	//Warms the OS page cache for ModelParams.PathToModel ahead of a LoadModel, e.g. when a level starts streaming in
+	void PrefetchModelFile();
+
 	//Prompt input
 	void InsertTemplatedPrompt(const FLlamaChatPrompt& Prompt, 
 		TFunction<void(const FString& Response)>OnResponseFinished = nullptr);
@@ -40,6 +68,9 @@ public:
 	void ImpersonateTemplatedPrompt(const FLlamaChatPrompt& Prompt);
 	void ImpersonateTemplatedToken(const FString& Token, EChatTemplateRole Role = EChatTemplateRole::Assistant, bool bEoS = false);
 	bool IsGenerating();
+
+	//Stops the request running right now: ends generation, or aborts its prompt/embedding decode (nothing is inserted,
+	//OnError reports the cancel). Requests queued behind it still run, UnloadModel/CancelModelLoad drop queued work too.
 	void StopGeneration();
 	void ResumeGeneration();
 
@@ -73,6 +104,21 @@ public:
 	//Embed a prompt and return the embeddings
 	void GetPromptEmbeddings(const FString& Text, TFunction<void(const TArray<float>& Embeddings, const FString& SourceText)>OnEmbeddings = nullptr);
 
+	//Scores each candidate against Query with a reranker model, Results are sorted best first and cut to TopN (0 = all).
+	//Typical use: FindNearestNStrings for ~50 cheap candidates, rerank to the best few for the prompt.
+	void RerankDocuments(const FString& Query, const TArray<FString>& Candidates, int32 TopN = 0,
+		TFunction<void(const TArray<FLlamaRerankResult>& Results, const FString& Query)>OnRerank = nullptr);
+
+	//Embed a long text as overlapping windows. DocumentEmbedding is empty for PerChunk aggregation.
+	void GetDocumentEmbeddings(const FString& Text, ELlamaEmbeddingAggregation Aggregation,
+		TFunction<void(const TArray<FLlamaEmbeddingChunk>& Chunks, const TArray<float>& DocumentEmbedding, const FString& SourceText)>OnEmbeddings = nullptr);
+
+	//Embed many texts with packed decodes. Embeddings is SourceTexts.Num() x Dimensions floats in input order, empty on error.
+	//bCallbackOnGameThread=false calls OnEmbeddings directly on the BG thread, for pipelines that shouldn't touch the GT.
+	//ShouldCancel is polled on the BG thread before and during the decode, a cancelled batch returns empty Embeddings.
+	void GetPromptEmbeddingsBatch(const TArray<FString>& Texts, TFunction<void(const TArray<float>& Embeddings, int32 Dimensions, const TArray<FString>& SourceTexts)>OnEmbeddings = nullptr,
+		bool bCallbackOnGameThread = true, TFunction<bool()> ShouldCancel = nullptr);
+
 	FLlamaNative();
 	~FLlamaNative();
 
@@ -101,15 +147,49 @@ protected:
 	FString CombinedPieceText;	//accumulates tokens into full string during per-token inference.
 	FString CombinedTextOnPartialEmit; //state needed to check if on finish we've emitted all partials (broken grammar).
 
+	//Model loading, BG thread only
+	void FinalizeModelLoad(bool bSuccess, const FLLMModelParams& ParamsAtLoad, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback, int64 TaskId);
+
+	//Loads into a separate internal on its own thread, swapped in on the BG thread when ready.
+	//If one is already pending it gets cancelled and this one is queued to start when it finishes.
+	void LoadModelInBackground(const FLLMModelParams& ParamsAtLoad, TFunction<void(const FString&, int32 StatusCode)> ModelLoadedCallback, TSharedPtr<FStructuredChatHistory> MigratedHistory = nullptr);
+
+	//Returns false if the target was cancelled or a message failed to decode, the replay is then incomplete
+	bool ReplayChatHistory(class FLlamaInternal* Target, const FStructuredChatHistory& History, int32 StartIndex = 0);
+	void BindInternalCallbacks(class FLlamaInternal* Target);
+	void RetireInternal(class FLlamaInternal* Retired);
+
+	//Cancels the pending background load and drops a queued one, never touches the serving internal
+	void CancelPendingLoad();
+
+	struct FBackgroundLoad
+	{
+		FLLMModelParams Params;
+		TFunction<void(const FString&, int32 StatusCode)> Callback;
+		TSharedPtr<FStructuredChatHistory> MigratedHistory;
+	};
+	void StartBackgroundLoad(TSharedPtr<FBackgroundLoad> Load);	//PendingLoadMutex must be held
+	void FailBackgroundLoad(TSharedPtr<FBackgroundLoad> Load);
+
+	FCriticalSection PendingLoadMutex;	//guards PendingInternal, QueuedLoad and bBackgroundLoadsBlocked
+	class FLlamaInternal* PendingInternal = nullptr;
+	TSharedPtr<FBackgroundLoad> QueuedLoad;
+	FThreadSafeBool bBackgroundLoadsBlocked = false;	//set on destruction, also aborts placement and embedding benchmarks
+	TArray<class FLlamaInternal*> RetiredInternals;	//BG thread only
+	FThreadSafeCounter ActiveLoaderThreads = 0;	//background loads and benchmarks, all capture this
+
 	//Threading
 	void StartLLMThread();
-	TQueue<FLLMThreadTask> BackgroundTasks;
-	TQueue<FLLMThreadTask> GameThreadTasks;
+	TQueue<FLLMThreadTask, EQueueMode::Mpsc> BackgroundTasks;	//Mpsc: background model loads also enqueue
+	TQueue<FLLMThreadTask, EQueueMode::Mpsc> GameThreadTasks;
 	FThreadSafeBool bThreadIsActive = false;
 	FThreadSafeBool bThreadShouldRun = false;
 	FThreadSafeCounter TaskIdCounter = 0;
 	int64 GetNextTaskId();
 
+	//Shared with the active internal, cancels bump it and BG tasks snapshot it when enqueued
+	TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> RequestCancelGeneration = MakeShared<FThreadSafeCounter, ESPMode::ThreadSafe>();
+
 	void EnqueueBGTask(TFunction<void(int64)> Task);
 	void EnqueueGTTask(TFunction<void()> Task, int64 LinkedTaskId = -1);
 
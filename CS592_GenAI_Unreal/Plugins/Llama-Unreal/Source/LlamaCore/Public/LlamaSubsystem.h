@@ -2,6 +2,8 @@
 
 #pragma once
 #include "LlamaDataTypes.h"
+#include "LlamaModelCatalog.h"
+#include "Embedding/LlamaEmbeddingBenchmark.h"
 #include "Tickable.h"
 #include "Subsystems/EngineSubsystem.h"
 
@@ -9,7 +11,8 @@
 
 /** 
 * Engine Sub-system type access to LLM. Survives level transitions and PIE start/stop. 
-* Limited to one active model, if more are needed in parallel, use LlamaComponent API.
+* Has one main model (ModelParams) plus an optional pool of named models that share PooledMemoryBudgetMB
+* with LRU eviction. For per-actor models, use LlamaComponent API.
 */
 
 UCLASS(Category = "LLM")
@@ -35,6 +38,10 @@ public:
     UPROPERTY(BlueprintAssignable)
     FOnPromptProcessedSignature OnPromptProcessed;
 
+    //Emitted after each decoded prompt chunk; TokensProcessed of TokensTotal for the current prompt
+    UPROPERTY(BlueprintAssignable)
+    FOnPromptProgressSignature OnPromptProgress;
+
     UPROPERTY(BlueprintAssignable)
     FVoidEventSignature OnStartEval;
 
@@ -48,10 +55,36 @@ public:
     UPROPERTY(BlueprintAssignable)
     FModelNameSignature OnModelLoaded;
 
+    //0-1 progress while model weights are loading
+    UPROPERTY(BlueprintAssignable)
+    FOnModelLoadProgressSignature OnModelLoadProgress;
+
     //Catch internal errors
     UPROPERTY(BlueprintAssignable)
     FOnErrorSignature OnError;
 
+    //Model pool events
+    UPROPERTY(BlueprintAssignable)
+    FOnPooledTextSignature OnPooledTokenGenerated;
+
+    UPROPERTY(BlueprintAssignable)
+    FOnPooledTextSignature OnPooledPartialGenerated;
+
+    UPROPERTY(BlueprintAssignable)
+    FOnPooledTextSignature OnPooledResponseGenerated;
+
+    UPROPERTY(BlueprintAssignable)
+    FOnPooledEmbeddingsSignature OnPooledEmbeddings;
+
+    UPROPERTY(BlueprintAssignable)
+    FPooledModelNameSignature OnPooledModelLoaded;
+
+    UPROPERTY(BlueprintAssignable)
+    FPooledModelNameSignature OnPooledModelEvicted;
+
+    UPROPERTY(BlueprintAssignable)
+    FOnPooledErrorSignature OnPooledError;
+
     //Modify these before loading model to apply settings
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Subsystem")
     FLLMModelParams ModelParams;
@@ -75,9 +108,25 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
     void UnloadModel();
 
+    //Aborts an in-progress model load
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void CancelModelLoad();
+
+    //Swaps to a different model without going mute, the current model serves until the new one is ready. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void SwapModel(const FLLMModelParams& NewParams, bool bMigrateChatHistory = true);
+
     UFUNCTION(BlueprintPure, Category = "LLM Model Subsystem")
     bool IsModelLoaded();
 
+    //Swap persona adapters on the loaded model, much cheaper than a model load or a long system prompt. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void SetLoraAdapters(const TArray<FLlamaLoraAdapter>& Adapters);
+
+    //Steer tone (e.g. mood) with blended control vectors, costs no prompt tokens. Empty array clears. Updates ModelParams.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void SetControlVectors(const TArray<FLlamaControlVector>& Vectors);
+
     //Clears the prompt, allowing a new context - optionally keeping the initial system prompt
     UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
     void ResetContextHistory(bool bKeepSystemPrompt = false);
@@ -108,6 +157,63 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
     void ResumeGeneration();
 
+    //Header-only scan of the models folder, cached between calls unless bForceRescan
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    TArray<FLlamaModelInfo> GetModelCatalog(bool bForceRescan = false);
+
+    //Estimated weights + KV budget for pooled models, least recently used idle models get unloaded to fit. 0 = unlimited.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LLM Model Subsystem|Pool")
+    int32 PooledMemoryBudgetMB = 0;
+
+    //Registers a named model, it loads on first use or via prewarm
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void RegisterPooledModel(FName ModelName, const FLLMModelParams& Params);
+
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void UnregisterPooledModel(FName ModelName);
+
+    //Load ahead of use, only prefetches the file if it wouldn't fit the budget
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void PrewarmPooledModel(FName ModelName);
+
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void UnloadPooledModel(FName ModelName);
+
+    //Prewarms ModelName when MapName starts loading (map travel) or streams in (sublevel)
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void AddPooledModelMapHint(FName MapName, FName ModelName);
+
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void InsertTemplatedPromptToPooledModel(FName ModelName, const FLlamaChatPrompt& ChatPrompt);
+
+    //Result arrives via OnPooledEmbeddings
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void GetPooledPromptEmbeddings(FName ModelName, const FString& Text);
+
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem|Pool")
+    void StopPooledGeneration(FName ModelName);
+
+    UFUNCTION(BlueprintPure, Category = "LLM Model Subsystem|Pool")
+    bool IsPooledModelResident(FName ModelName);
+
+    UFUNCTION(BlueprintPure, Category = "LLM Model Subsystem|Pool")
+    TArray<FName> GetResidentPooledModels();
+
+    UPROPERTY(BlueprintAssignable)
+    FOnPlacementBenchmarkSignature OnPlacementBenchmarkComplete;
+
+    //Measures tok/s for each tensor placement preset using ModelParams, result via OnPlacementBenchmarkComplete and the log
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void BenchmarkTensorPlacement();
+
+    UPROPERTY(BlueprintAssignable)
+    FOnEmbeddingBenchmarkSignature OnEmbeddingBenchmarkComplete;
+
+    //Embedding texts/s and tokens/s per thread count plus vector index recall@k/latency using ModelParams' model.
+    //JSON report goes to Saved/Benchmarks, result via OnEmbeddingBenchmarkComplete.
+    UFUNCTION(BlueprintCallable, Category = "LLM Model Subsystem")
+    void BenchmarkEmbeddings(const FLlamaEmbeddingBenchmarkParams& BenchParams);
+
     //Temporary for testing purposes
     UFUNCTION(BlueprintCallable, Category = "TESTING")
     void TestVectorSearch();
@@ -121,4 +227,13 @@ public:
 
 private:
     class FLlamaNative* LlamaNative;
+    class FLlamaModelPool* ModelPool;
+
+    //Budget is synced from the UPROPERTY before each pool operation
+    class FLlamaModelPool* GetModelPool();
+
+    void HandlePreLoadMap(const FString& MapName);
+    void HandleLevelAddedToWorld(ULevel* InLevel, UWorld* InWorld);
+    FDelegateHandle PreLoadMapHandle;
+    FDelegateHandle LevelAddedHandle;
 };
@@ -16,6 +16,9 @@ public:
 
 	//Utility function for debugging model location and file enumeration
 	static TArray<FString> DebugListDirectoryContent(const FString& InPath);
+
+	//Reads the file on a background thread to warm the OS page cache (WILLNEED style), repeat calls for an in-flight file are ignored
+	static void PrefetchFileAsync(const FString& InFullPath);
 };
 
 class FLlamaString
@@ -688,8 +688,12 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     void saveIndex(const std::string &location) {
         std::ofstream output(location, std::ios::binary);
-        std::streampos position;
+        saveIndex(output);
+        output.close();
+    }
 
+    // Stream variants let the caller own file I/O (e.g. engine file systems with non-ASCII paths)
+    void saveIndex(std::ostream &output) {
         writeBinaryPOD(output, offsetLevel0_);
         writeBinaryPOD(output, max_elements_);
         writeBinaryPOD(output, cur_element_count);
@@ -713,7 +717,6 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             if (linkListSize)
                 output.write(linkLists_[i], linkListSize);
         }
-        output.close();
     }
 
 
@@ -728,6 +731,21 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         if (!input.is_open())
             return Status("Cannot open file");
 
+        Status status = loadIndexNoExceptions(input, s, max_elements_i);
+        input.close();
+        return status;
+    }
+
+    Status loadIndexNoExceptions(std::istream &input, SpaceInterface<dist_t> *s, size_t max_elements_i = 0) {
+        Status status = loadIndexFromStream(input, s, max_elements_i);
+        if (!status.ok()) {
+            // header fields were already read, don't let clear() walk link lists that were never allocated
+            cur_element_count = 0;
+        }
+        return status;
+    }
+
+    Status loadIndexFromStream(std::istream &input, SpaceInterface<dist_t> *s, size_t max_elements_i) {
         clear();
         // get file size:
         input.seekg(0, input.end);
@@ -825,8 +843,6 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             }
         }
 
-        input.close();
-
         return OkStatus();
     }
 